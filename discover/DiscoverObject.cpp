@@ -9,8 +9,10 @@
 #include "UnityLauncher.h"
 #include "FeaturedModel.h"
 #include "CachedNetworkAccessManager.h"
+#include "RemoteImageProvider.h"
 #include "DiscoverDeclarativePlugin.h"
 #include "DiscoverBackendsFactory.h"
+#include <resources/StringPool.h>
 
 // Qt includes
 #include <QAction>
@@ -52,6 +54,9 @@
 #include <resources/ResourcesProxyModel.h>
 #include <Category/Category.h>
 #include <Category/CategoryModel.h>
+#include <network/HttpClient.h>
+#include <network/networkutils.h>
+#include <network/ImageCache.h>
 
 #include <functional>
 #include <cmath>
@@ -95,11 +100,22 @@ DiscoverObject::DiscoverObject(CompactMode mode, const QVariantMap &initialPrope
     , m_networkAccessManagerFactory(new CachedNetworkAccessManagerFactory)
 {
     setObjectName(QStringLiteral("DiscoverMain"));
+    // the handshake with the store API happens while the backends load
+    HttpClient::global()->preconnect(QUrl(QStringLiteral(BASE_URL)));
+    // sends the reports queued by previous sessions
+    NetworkUtils::global();
     m_engine->rootContext()->setContextObject(new KLocalizedContext(m_engine));
     auto factory = m_engine->networkAccessManagerFactory();
     m_engine->setNetworkAccessManagerFactory(nullptr);
     delete factory;
     m_engine->setNetworkAccessManagerFactory(m_networkAccessManagerFactory.data());
+    // screenshots that were seen before stay visible while offline
+    connect(ResourcesModel::global(), &ResourcesModel::networkStateChanged, this, [](const QString &state) {
+        CachedNetworkAccessManager::setOffline(state == QLatin1String("1"));
+    });
+    // remote icons and banners, decoded off the GUI thread
+    ImageCache::global()->setMaximumSize(qint64(DiscoverSettings().imageCacheSize()) * 1024 * 1024);
+    m_engine->addImageProvider(QStringLiteral("remote"), new RemoteImageProvider);
 
     qmlRegisterType<UnityLauncher>("org.kde.discover.app", 1, 0, "UnityLauncher");
     qmlRegisterType<PaginateModel>("org.kde.discover.app", 1, 0, "PaginateModel");
@@ -399,6 +415,16 @@ QString DiscoverObject::iconName(const QIcon& icon)
     return icon.name();
 }
 
+QVariantMap DiscoverObject::imageCacheStats()
+{
+    return ImageCache::global()->stats();
+}
+
+QVariantMap DiscoverObject::memoryReport()
+{
+    return StringPool::global()->report();
+}
+
 void DiscoverObject::aboutApplication()
 {
     static QPointer<QDialog> dialog;
@@ -43,6 +43,10 @@ public:
 
     Q_SCRIPTABLE QAction * action(const QString& name) const;
     Q_SCRIPTABLE static QString iconName(const QIcon& icon);
+    /** how often remote icons, banners and screenshots were answered from the caches, see ImageCache::stats() */
+    Q_SCRIPTABLE static QVariantMap imageCacheStats();
+    /** what the shared metadata strings hold and save, next to the resident set */
+    Q_SCRIPTABLE static QVariantMap memoryReport();
 
     void loadTest(const QUrl& url);
 
@@ -0,0 +1,42 @@
+/*
+ *   SPDX-FileCopyrightText: 2021 Wang Rui <wangrui@jingos.com>
+ *
+ *   SPDX-License-Identifier: LGPL-2.0-or-later
+ */
+
+#include "RemoteImageProvider.h"
+#include <network/ImageCache.h>
+
+class RemoteImageResponse : public QQuickImageResponse
+{
+public:
+    RemoteImageResponse(const QUrl &url, const QSize &size)
+    {
+        // requested from the image loader thread, the cache lives in the GUI thread
+        ImageCache *cache = ImageCache::global();
+        QMetaObject::invokeMethod(cache, [this, cache, url, size] {
+            cache->load(url, size, this, [this](const QImage &image) {
+                m_image = image;
+                emit finished();
+            });
+        }, Qt::QueuedConnection);
+    }
+
+    QString errorString() const override
+    {
+        return m_image.isNull() ? QStringLiteral("Could not load the image") : QString();
+    }
+
+    QQuickTextureFactory *textureFactory() const override
+    {
+        return QQuickTextureFactory::textureFactoryForImage(m_image);
+    }
+
+private:
+    QImage m_image;
+};
+
+QQuickImageResponse *RemoteImageProvider::requestImageResponse(const QString &id, const QSize &requestedSize)
+{
+    return new RemoteImageResponse(QUrl(id), requestedSize);
+}
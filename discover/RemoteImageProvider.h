@@ -0,0 +1,22 @@
+/*
+ *   SPDX-FileCopyrightText: 2021 Wang Rui <wangrui@jingos.com>
+ *
+ *   SPDX-License-Identifier: LGPL-2.0-or-later
+ */
+
+#ifndef REMOTEIMAGEPROVIDER_H
+#define REMOTEIMAGEPROVIDER_H
+
+#include <QQuickAsyncImageProvider>
+
+/**
+ * image://remote/<url> loads @url through ImageCache, scaled down to the
+ * sourceSize of the Image. Nothing gets decoded in the GUI thread.
+ */
+class RemoteImageProvider : public QQuickAsyncImageProvider
+{
+public:
+    QQuickImageResponse *requestImageResponse(const QString &id, const QSize &requestedSize) override;
+};
+
+#endif
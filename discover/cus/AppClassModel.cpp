@@ -10,15 +10,13 @@
 #include <QJsonValue>
 #include <QString>
 #include <network/HttpClient.h>
+#include <resources/ResourcesModel.h>
 #include <QLocale>
 #include <QFileDevice>
+#include <QSaveFile>
 #include <QNetworkReply>
 
 #define CACHE_PATH "/usr/share/discover/pkcategories/categoriesinfo.json"
-#define IF_MODIFIED_SINCE "If-Modified-Since"
-#define IF_NONE_MATCH "If-None-Match"
-#define LAST_MODIFIED "Last-Modified"
-#define ETAG "Etag"
 
 LocalAppModelThread::LocalAppModelThread()
 {
@@ -101,6 +99,12 @@ void AppClassModel::populate()
 
     iconBaseUrlget();
     categoryCache();
+    // offline the categories came from categoriesinfo.json, ask again once back online
+    connect(ResourcesModel::global(), &ResourcesModel::networkStateChanged, this, [this](const QString &state) {
+        if (state == QLatin1String("2") && !m_networkSuc) {
+            requestCategories();
+        }
+    });
 }
 
 void AppClassModel::iconBaseUrlget()
@@ -151,88 +155,115 @@ QString AppClassModel::currentCategoriesName(QString categories)
 
 QString AppClassModel::categoryCache()
 {
-    if (lastModified != "") {
-        headers.insert(IF_MODIFIED_SINCE,lastModified);
-    }
-    if (etag != "") {
-        headers.insert(IF_NONE_MATCH,etag);
+    requestCategories();
+    if (localThread->isRunning()) {
+        localThread->quit();
     }
+    localThread->start();
+    return {};
+}
+
+void AppClassModel::requestCategories()
+{
     HttpClient::global() -> get(QLatin1String(BASE_URL) + QLatin1String(CATEGORY_URL))
-    .headers(headers)
-    .onResponse([this](QNetworkReply* result) {
-        bool isExistETAG = result->hasRawHeader(ETAG);
-        if (isExistETAG) {
-            etag = result->rawHeader(ETAG);
-            lastModified = result->rawHeader(LAST_MODIFIED);
-        }
-        QByteArray serverResult = result->readAll();
-        if (serverResult.isEmpty()) {
+    .cachePolicy(HttpRequest::StaleWhileRevalidate)
+    .onDecoded(this, [lang = currentLang](const QByteArray &serverResult) {
+        return serverResult.isEmpty() ? CategoryList() : decodeCategories(serverResult, true, lang);
+    }, [this](const CategoryList &list) {
+        if (!list.received) {
             return;
         }
+        m_networkSuc = true;
         emit networkStop(true);
-        createbannerData(serverResult,true);
+        if (!list.json.isEmpty()) {
+            // replaced at once, LocalAppModelThread never reads half of it
+            QSaveFile app_json(QStandardPaths::locate(QStandardPaths::GenericDataLocation, QLatin1String("discover/pkcategories/categoriesinfo.json")));
+            if (!app_json.fileName().isEmpty() && app_json.open(QIODevice::WriteOnly)) {
+                app_json.write(list.json);
+                app_json.commit();
+            }
+        }
+        setCategories(list);
     })
     .onError([this](QString errorStr) {
+        m_networkSuc = false;
         emit networkStop(false);
         return;
     })
     .timeout(10 * 1000)
     .removePublicQueryParams()
     .exec();
-    if (localThread->isRunning()) {
-        localThread->quit();
-    }
-    localThread->start();
-    return {};
 }
 
 void AppClassModel::createbannerData(QByteArray jsonData,bool isNetworkRequest)
 {
+    setCategories(decodeCategories(jsonData, isNetworkRequest, currentLang));
+}
 
+AppClassModel::CategoryList AppClassModel::decodeCategories(const QByteArray &jsonData, bool isNetworkRequest, const QString &lang)
+{
+    CategoryList list;
+    list.received = true;
     if (isNetworkRequest) {
         QString path = QStandardPaths::locate(QStandardPaths::GenericDataLocation, QLatin1String("discover/pkcategories/categoriesinfo.json"));
         QFile app_json(path);
-        if (app_json.open(QIODevice::ReadWrite)) {
-            QByteArray fileData =  app_json.readAll();
-            if (jsonData == fileData) {
-                return;
-            }
-            app_json.resize(0);
-            app_json.write(jsonData);
-            app_json.close();
+        if (app_json.open(QIODevice::ReadOnly) && app_json.readAll() == jsonData) {
+            return list;
         }
+        list.json = jsonData;
     }
-    beginResetModel();
-    m_categories.clear();
-    m_categories.append(new Category(i18n("Feature applications")
-                                     ,QString::fromUtf8("feature_applications")
-                                     ,appTypeRemote));
+    list.changed = true;
 
     QJsonObject jsonObjet= QJsonDocument::fromJson(jsonData).object();
     if (jsonObjet.empty()) {
-        return;
+        return list;
     }
     int code = jsonObjet["code"].toInt();
     if (code != 200) {
-        return;
+        return list;
     }
+    list.valid = true;
     QJsonArray jsonArray = jsonObjet["categories"].toArray();
     foreach (auto json, jsonArray) {
-        Category *category = new Category();
-        category->setApptype(appTypeRemote);
         QJsonObject categoryObject = json.toObject();
         QString typeP =  categoryObject[QString::fromUtf8("type")].toString();
-        category->setTypeName(typeP);
+        QString displayP;
         QJsonArray displaysArray = json[QString::fromUtf8("displays")].toArray();
         foreach (auto display, displaysArray) {
             QJsonObject displayObject = display.toObject();
             QString langP =  displayObject[QString::fromUtf8("lang")].toString();
-            if (langP == currentLang) {
-                QString displayP =  displayObject[QString::fromUtf8("display")].toString();
-                category->setName(displayP);
-                m_cacheCategoriesMap.insert(typeP,displayP);
+            if (langP == lang) {
+                displayP =  displayObject[QString::fromUtf8("display")].toString();
             }
         }
+        list.categories.append({typeP, displayP});
+    }
+    return list;
+}
+
+void AppClassModel::setCategories(const CategoryList &list)
+{
+    if (!list.changed) {
+        return;
+    }
+
+    beginResetModel();
+    m_categories.clear();
+    m_categories.append(new Category(i18n("Feature applications")
+                                     ,QString::fromUtf8("feature_applications")
+                                     ,appTypeRemote));
+    if (!list.valid) {
+        endResetModel();
+        return;
+    }
+    for (const auto &entry : list.categories) {
+        Category *category = new Category();
+        category->setApptype(appTypeRemote);
+        category->setTypeName(entry.first);
+        if (!entry.second.isNull()) {
+            category->setName(entry.second);
+            m_cacheCategoriesMap.insert(entry.first, entry.second);
+        }
         m_categories.append(category);
     }
     m_categories.append(new Category(i18n("SoftWare update")
@@ -243,4 +274,3 @@ void AppClassModel::createbannerData(QByteArray jsonData,bool isNetworkRequest)
                                      ,appTypeMy));
     endResetModel();
 }
-
@@ -67,13 +67,23 @@ public Q_SLOTS:
     void setIconBaseUrl(QString iconBaseurl);
 
 private:
+    /* what a categories response turns into on HttpClient's decoder threads */
+    struct CategoryList {
+        bool received = false;
+        bool changed = false;
+        bool valid = false;
+        QByteArray json; // for categoriesinfo.json, the decoders do not write it
+        QVector<QPair<QString, QString>> categories; // type, display name
+    };
+    static CategoryList decodeCategories(const QByteArray &jsonData, bool isNetworkRequest, const QString &lang);
+    void setCategories(const CategoryList &list);
+    void requestCategories();
+
     QVector<AppClass*> mAppClasses;
     QVector<Category*> m_categories;
     LocalAppModelThread *localThread;
-    QMap<QString, QVariant> headers;
     QMap<QString, QString> m_cacheCategoriesMap;
-    QString etag;
-    QString lastModified;
+    bool m_networkSuc = false;
     QString appTypeRemote = i18n("Application classification");
     QString appTypeMy = i18n("My");
 
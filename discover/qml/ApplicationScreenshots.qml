@@ -19,6 +19,8 @@ ListView {
     readonly property alias count: screenshotsModel.count
     property alias resource: screenshotsModel.application
     property var resource
+    // the first screenshot loads alone, the others follow together
+    property bool firstLoaded: false
 
     spacing: 20//Kirigami.Units.largeSpacing
     focus: overlay.visible
@@ -41,8 +43,13 @@ ListView {
         implicitHeight: root.height
         padding: Kirigami.Units.largeSpacing
         hoverEnabled: true
+        onHoveredChanged: {
+            if (hovered)
+                screenshotsModel.prefetchScreenshot(index)
+        }
         // onClicked: overlay.open()
         onClicked: {
+            screenshotsModel.prefetchScreenshots()
             Nav.openBigImg(appScreenShots)
         }
         // TODO cursorShape: Qt.PointingHandCursor
@@ -71,7 +78,11 @@ ListView {
                 running: thumbnail.status == Image.Loading
                 anchors.centerIn: parent
             }
-            url: small_image_url
+            url: index === 0 || root.firstLoaded ? small_image_url : ""
+            onStatusChanged: {
+                if (index === 0 && status !== Image.Loading)
+                    root.firstLoaded = true
+            }
         }
     }
 
@@ -109,7 +109,8 @@ Kirigami.AbstractCard {
                 anchors.centerIn: resourceIcon
                 width: parent.width - 2
                 height: parent.height - 2
-                source: application.icon
+                source: Navigation.remoteImage(application.icon)
+                sourceSize: Qt.size(width, height)
                 visible: false
                 asynchronous: true
                 fillMode: Image.Stretch
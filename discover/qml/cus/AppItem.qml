@@ -9,6 +9,7 @@ import QtQuick 2.12
 import QtQuick.Controls 2.12
 import QtQuick.Layouts 1.3
 import "nav.js" as Nav
+import "../navigation.js" as Navigation
 
 Item {
     property var itemWidth
@@ -30,7 +31,9 @@ Item {
         }
         width: w()
         height: w()
-        source: application.icon
+        source: Navigation.remoteImage(application.icon)
+        sourceSize: Qt.size(width, height)
+        asynchronous: true
 
         function w() {
             return app_grid.cellHeight - 50
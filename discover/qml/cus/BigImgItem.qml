@@ -15,6 +15,7 @@ Item {
     property var url
     property var dismissVisibility: false
     property int imageRadius: 10 * appScaleSize
+    readonly property alias status: bigImageView.status
     RectDropshadow {
         id: shadow
         color: "#FFFFFF"
@@ -26,7 +27,8 @@ Item {
         id: bigImageView
         width: parent.width - 1
         height: parent.height - 1
-        source: url
+        source: Nav.remoteImage(url)
+        sourceSize: Qt.size(width, height)
         visible: false
         asynchronous: true
         fillMode: Image.Stretch
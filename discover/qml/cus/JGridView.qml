@@ -31,4 +31,36 @@ GridView {
     ScrollBar.vertical: ScrollBar {
         active: true
     }
+
+    // models that page their results (ResourcesProxyModel.hasMore) are asked
+    // for the next page a couple of rows before the end is reached
+    function fetchMoreIfNeeded() {
+        if (model && model.hasMore && contentY - originY + height >= contentHeight - cellHeight * 2)
+            model.fetchMoreResources()
+    }
+    // the icons of the screen below the viewport are downloaded before they get
+    // scrolled to, including the rows the last fetchMoreResources() brought in
+    property int prefetchedRow: -1
+    property int prefetchedCount: -1
+    function prefetchIfNeeded() {
+        if (!model || model.prefetchIcons === undefined || cellWidth <= 0 || cellHeight <= 0)
+            return
+        var perRow = Math.max(1, Math.floor(width / cellWidth))
+        var first = Math.ceil((contentY - originY + height) / cellHeight) * perRow
+        if (first === prefetchedRow && count === prefetchedCount)
+            return
+        prefetchedRow = first
+        prefetchedCount = count
+        model.prefetchIcons(first, Math.ceil(height / cellHeight) * perRow)
+    }
+    Connections {
+        target: root
+        function onContentYChanged() { root.fetchMoreIfNeeded(); root.prefetchIfNeeded() }
+        function onContentHeightChanged() { root.fetchMoreIfNeeded(); root.prefetchIfNeeded() }
+    }
+    Connections {
+        target: root.model && root.model.hasMore !== undefined ? root.model : null
+        ignoreUnknownSignals: true
+        function onBusyChanged() { root.fetchMoreIfNeeded() }
+    }
 }
@@ -4,6 +4,13 @@
  *   SPDX-License-Identifier: LGPL-2.0-or-later
  */
 
+// remote images are decoded and scaled by the "remote" image provider, off the GUI thread
+function remoteImage(url)
+{
+    var source = String(url)
+    return /^https?:\/\//.test(source) ? "image://remote/" + source : url
+}
+
 function clearStack()
 {
     window.currentTopLevel = ""
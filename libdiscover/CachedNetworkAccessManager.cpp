@@ -6,27 +6,37 @@
  */
 
 #include "CachedNetworkAccessManager.h"
+#include "network/HttpCache.h"
 
-#include <QNetworkDiskCache>
+#include <QNetworkReply>
 #include <QNetworkRequest>
 #include <QStandardPaths>
-#include <QStorageInfo>
+
+#define CACHE_SIZE (50 * 1024 * 1024)
+
+// QML creates a manager for every thread loading something
+static QAtomicInt s_offline;
 
 CachedNetworkAccessManager::CachedNetworkAccessManager(const QString &path, QObject *parent)
     : KIO::AccessManager(parent)
 {
     const QString cacheDir = QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + QLatin1Char('/') + path;
-    QNetworkDiskCache *cache = new QNetworkDiskCache(this);
-    QStorageInfo storageInfo(cacheDir);
-    cache->setCacheDirectory(cacheDir);
-    cache->setMaximumCacheSize(storageInfo.bytesTotal() / 1000);
-    setCache(cache);
+    setCache(new HttpCache(cacheDir, CACHE_SIZE, this));
 }
 
 QNetworkReply * CachedNetworkAccessManager::createRequest(Operation op, const QNetworkRequest &request, QIODevice *outgoingData)
 {
     QNetworkRequest req(request);
-    req.setAttribute(QNetworkRequest::CacheLoadControlAttribute, QNetworkRequest::PreferCache);
-    return KIO::AccessManager::createRequest(op, request, outgoingData);
+    req.setAttribute(QNetworkRequest::CacheLoadControlAttribute, s_offline.loadRelaxed() ? QNetworkRequest::AlwaysCache : QNetworkRequest::PreferCache);
+
+    const QString scheme = req.url().scheme();
+    if (scheme != QLatin1String("http") && scheme != QLatin1String("https"))
+        return KIO::AccessManager::createRequest(op, req, outgoingData);
+
+    return QNetworkAccessManager::createRequest(op, req, outgoingData);
 }
 
+void CachedNetworkAccessManager::setOffline(bool offline)
+{
+    s_offline.storeRelaxed(offline);
+}
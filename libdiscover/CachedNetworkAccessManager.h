@@ -12,6 +12,13 @@
 #include <QQmlNetworkAccessManagerFactory>
 #include <KIO/AccessManager>
 
+/**
+ * Network access manager that answers from its disk cache whenever it can.
+ *
+ * http(s) requests go through QNetworkAccessManager itself, KIO would use its
+ * own cache instead. Cached responses are used even when stale, and only them
+ * while offline. Managers created with the same @p path share one directory.
+ */
 class Q_DECL_EXPORT CachedNetworkAccessManager : public KIO::AccessManager
 {
     Q_OBJECT
@@ -19,7 +26,9 @@ public:
     explicit CachedNetworkAccessManager(const QString &path, QObject *parent = nullptr);
 
     virtual QNetworkReply * createRequest(Operation op, const QNetworkRequest &request, QIODevice *outgoingData = nullptr) override;
+
+    /* While offline nothing that is not cached is requested */
+    static void setOffline(bool offline);
 };
 
 #endif // CACHEDNETWORKACCESSMANAGER_H
-
@@ -14,6 +14,21 @@
 #include "libdiscover_debug.h"
 #include <utils.h>
 #include <QFileInfo>
+#include <QMutex>
+#include <functional>
+#include <queue>
+#include <vector>
+
+static QAtomicInt s_filtersGeneration;
+
+// the indices of the live categories, the smallest free one is handed out first
+// so the category bitsets stay as wide as there are categories
+struct CategoryIndices {
+    QMutex mutex;
+    int next = 0;
+    std::priority_queue<int, std::vector<int>, std::greater<int>> free;
+};
+Q_GLOBAL_STATIC(CategoryIndices, s_indices)
 
 Category::Category()
 {}
@@ -47,7 +62,10 @@ Category::Category(const QString& name, const QString& iconName, const QVector<Q
     setObjectName(m_name);
 }
 
-Category::~Category() = default;
+Category::~Category()
+{
+    releaseIndex(m_index);
+}
 
 void Category::parseData(const QString& path, const QDomNode& data)
 {
@@ -96,10 +114,13 @@ QVector<QPair<FilterType, QString> > Category::parseIncludes(const QDomNode &dat
         if (tempElement.tagName() == QLatin1String("And")) {
             // Parse children
             m_andFilters.append(parseIncludes(node));
+            filtersChanged();
         } else if (tempElement.tagName() == QLatin1String("Or")) {
             m_orFilters.append(parseIncludes(node));
+            filtersChanged();
         } else if (tempElement.tagName() == QLatin1String("Not")) {
             m_notFilters.append(parseIncludes(node));
+            filtersChanged();
         } else if (tempElement.tagName() == QLatin1String("PkgSection")) {
             filter.append({ PkgSectionFilter, tempElement.text() });
         } else if (tempElement.tagName() == QLatin1String("Category")) {
@@ -145,6 +166,8 @@ void Category::setIconBaseUrl(const QString& baseUrl)
 {
     if (m_iconString.isEmpty()) {
         HttpClient::global() -> get(baseUrl + typeName() + ".png")
+        .cachePolicy(HttpRequest::CacheFirst)
+        .priority(HttpRequest::Prefetch)
         .onResponse([this](QByteArray result) {
             if (result.isEmpty()) {
                 return;
@@ -227,6 +250,7 @@ QVector<QPair<FilterType, QString> > Category::andFilters() const
 void Category::setAndFilter(QVector<QPair<FilterType, QString> > filters)
 {
     m_andFilters = filters;
+    filtersChanged();
 }
 
 QVector<QPair<FilterType, QString> > Category::orFilters() const
@@ -244,6 +268,73 @@ QVector<Category *> Category::subCategories() const
     return m_subCategories;
 }
 
+int Category::acquireIndex()
+{
+    QMutexLocker locker(&s_indices->mutex);
+    if (s_indices->free.empty())
+        return s_indices->next++;
+    const int index = s_indices->free.top();
+    s_indices->free.pop();
+    return index;
+}
+
+void Category::releaseIndex(int index)
+{
+    // categories that outlive the application's statics
+    if (s_indices.isDestroyed())
+        return;
+    {
+        QMutexLocker locker(&s_indices->mutex);
+        s_indices->free.push(index);
+    }
+    // what resources remember for the bit belongs to the next category that gets it
+    s_filtersGeneration.fetchAndAddRelaxed(1);
+}
+
+int Category::filtersGeneration()
+{
+    return s_filtersGeneration.loadAcquire();
+}
+
+void Category::filtersChanged()
+{
+    m_compiled = false;
+    s_filtersGeneration.fetchAndAddRelaxed(1);
+}
+
+static QString intern(const QString& token)
+{
+    // the same few categories and sections come back in every menu file
+    static QSet<QString> s_tokens;
+    auto it = s_tokens.constFind(token);
+    if (it == s_tokens.constEnd())
+        it = s_tokens.insert(token);
+    return *it;
+}
+
+static QVector<Category::Predicate> compile(const QVector<QPair<FilterType, QString> >& filters)
+{
+    QVector<Category::Predicate> ret;
+    ret.reserve(filters.size());
+    for (const auto& filter : filters) {
+        QString token = filter.second;
+        if (filter.first == PkgWildcardFilter || filter.first == AppstreamIdWildcardFilter)
+            token.remove(QLatin1Char('*'));
+        token = intern(token);
+        ret += Category::Predicate{ filter.first, token, QStringMatcher(token) };
+    }
+    return ret;
+}
+
+const Category::Predicates& Category::predicates() const
+{
+    if (!m_compiled) {
+        m_predicates = { compile(m_orFilters), compile(m_andFilters), compile(m_notFilters) };
+        m_compiled = true;
+    }
+    return m_predicates;
+}
+
 bool Category::categoryLessThan(Category *c1, const Category *c2)
 {
     return (!c1->isAddons() && c2->isAddons()) || (c1->isAddons()==c2->isAddons() && QString::localeAwareCompare(c1->name(), c2->name()) < 0);
@@ -294,6 +385,7 @@ void Category::addSubcategory(QVector< Category* >& list, Category* newcat)
         } else {
             c->m_orFilters += newcat->orFilters();
             c->m_notFilters += newcat->notFilters();
+            c->filtersChanged();
             c->m_plugins.unite(newcat->m_plugins);
             Q_FOREACH (Category* nc, newcat->subCategories()) {
                 addSubcategory(c->m_subCategories, nc);
@@ -11,6 +11,7 @@
 #include <QPair>
 #include <QObject>
 #include <QSet>
+#include <QStringMatcher>
 #include <QUrl>
 #include <network/HttpClient.h>
 
@@ -77,6 +78,28 @@ public:
     QVector<Category *> subCategories() const;
     QVariantList subCategoriesVariant() const;
 
+    /// A filter prepared to be matched against every resource
+    struct Predicate {
+        FilterType type;
+        /// the wildcards without their '*', shared by the categories using them
+        QString token;
+        QStringMatcher matcher;
+    };
+    struct Predicates {
+        QVector<Predicate> orFilters;
+        QVector<Predicate> andFilters;
+        QVector<Predicate> notFilters;
+    };
+    /// The filters, compiled the first time after they changed
+    const Predicates& predicates() const;
+    /// Small and unique among the live categories, the bit of the category in
+    /// AbstractResource's category bitsets. Reused once the category is gone.
+    int index() const {
+        return m_index;
+    }
+    /// Changes whenever the filters of any category change
+    static int filtersGeneration();
+
     static void sortCategories(QVector<Category*>& cats);
     static void addSubcategory(QVector<Category*>& cats, Category* cat);
     /**
@@ -119,9 +142,15 @@ private:
     QVector<Category *> m_subCategories;
 
     QVector<QPair<FilterType, QString> > parseIncludes(const QDomNode &data);
+    void filtersChanged();
+    static int acquireIndex();
+    static void releaseIndex(int index);
     QSet<QString> m_plugins;
     bool m_isAddons = false;
     QString m_iconCacheString;
+    const int m_index = acquireIndex();
+    mutable Predicates m_predicates;
+    mutable bool m_compiled = false;
 };
 
 #endif
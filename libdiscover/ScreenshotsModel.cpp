@@ -6,6 +6,7 @@
 
 #include "ScreenshotsModel.h"
 #include <resources/AbstractResource.h>
+#include <network/ImageCache.h>
 #include "libdiscover_debug.h"
 // #include <QAbstractItemModelTester>
 
@@ -36,6 +37,14 @@ void ScreenshotsModel::setResource(AbstractResource* res)
     m_resource = res;
     Q_EMIT resourceChanged(res);
 
+    if (!m_screenshots.isEmpty()) {
+        beginResetModel();
+        m_thumbnails.clear();
+        m_screenshots.clear();
+        endResetModel();
+        emit countChanged();
+    }
+
     if (res) {
         connect(m_resource, &AbstractResource::screenshotsFetched, this, &ScreenshotsModel::screenshotsFetched);
         res->fetchScreenshots();
@@ -51,14 +60,13 @@ AbstractResource* ScreenshotsModel::resource() const
 void ScreenshotsModel::screenshotsFetched(const QList< QUrl >& thumbnails, const QList< QUrl >& screenshots)
 {
     Q_ASSERT(thumbnails.count()==screenshots.count());
-    if (thumbnails.isEmpty())
+    // resources answer with what they parsed before, the delegates keep their images
+    if (thumbnails.isEmpty() || (thumbnails == m_thumbnails && screenshots == m_screenshots))
         return;
-    beginInsertRows(QModelIndex(), m_thumbnails.size(), m_thumbnails.size()+thumbnails.size()-1);
-    m_screenshots.clear();
-    m_thumbnails.clear();
-    m_thumbnails += thumbnails;
-    m_screenshots += screenshots;
-    endInsertRows();
+    beginResetModel();
+    m_thumbnails = thumbnails;
+    m_screenshots = screenshots;
+    endResetModel();
     emit countChanged();
 }
 
@@ -104,3 +112,14 @@ void ScreenshotsModel::remove(const QUrl& url)
         emit countChanged();
     }
 }
+
+void ScreenshotsModel::prefetchScreenshot(int row)
+{
+    if (row >= 0 && row < m_screenshots.count())
+        ImageCache::global()->prefetchOriginals({m_screenshots[row]});
+}
+
+void ScreenshotsModel::prefetchScreenshots()
+{
+    ImageCache::global()->prefetchOriginals(m_screenshots);
+}
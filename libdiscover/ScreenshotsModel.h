@@ -34,6 +34,11 @@ public:
 
     Q_INVOKABLE void remove(const QUrl &url);
 
+    /** Downloads the full size screenshot of @p row ahead of time, e.g. when it is hovered */
+    Q_INVOKABLE void prefetchScreenshot(int row);
+    /** Downloads every full size screenshot ahead of time, e.g. when the carousel opens */
+    Q_INVOKABLE void prefetchScreenshots();
+
 private Q_SLOTS:
     void screenshotsFetched(const QList<QUrl>& thumbnails, const QList<QUrl>& screenshots);
 
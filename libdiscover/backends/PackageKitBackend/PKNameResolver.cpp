@@ -0,0 +1,139 @@
+/*
+ *   SPDX-FileCopyrightText: 2021 Wang Rui <wangrui@jingos.com>
+ *   SPDX-License-Identifier: GPL-2.0-only OR GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+ */
+
+#include "PKNameResolver.h"
+#include <PackageKit/Daemon>
+#include "PackageKitBackend.h"
+
+#include <QDebug>
+
+PKNameResolver::PKNameResolver(PackageKitBackend* backend, PKResolvedCache* cache)
+    : QObject(backend)
+    , m_backend(backend)
+    , m_cache(cache)
+{
+    // everything requested before we get back to the event loop ends up in the same transaction
+    m_floodTimer.setInterval(0);
+    m_floodTimer.setSingleShot(true);
+    connect(&m_floodTimer, &QTimer::timeout, this, &PKNameResolver::start);
+}
+
+void PKNameResolver::resolve(const QStringList& packageNames, QObject* context, const std::function<void()>& done)
+{
+    QSet<QString> waiting;
+    QSet<QString> cachedIds;
+    for (const QString &name : packageNames) {
+        if (m_found.contains(name) || m_notFound.contains(name))
+            continue;
+
+        QVector<PKResolvedCache::Package> cached;
+        if (!m_inFlight.contains(name) && m_cache->lookup(name, &cached)) {
+            if (cached.isEmpty()) {
+                m_notFound.insert(name);
+                continue;
+            }
+            for (const auto &package : qAsConst(cached)) {
+                m_backend->addPackageArch(package.info, package.packageId, package.summary);
+                cachedIds += package.packageId;
+            }
+            m_found.insert(name);
+            continue;
+        }
+
+        waiting.insert(name);
+        if (!m_inFlight.contains(name))
+            m_pending.insert(name);
+    }
+    if (!cachedIds.isEmpty())
+        Q_EMIT packagesFound(cachedIds);
+
+    if (waiting.isEmpty()) {
+        QTimer::singleShot(0, context, done);
+        return;
+    }
+    m_waiters += Waiter { context, waiting, done };
+    if (!m_pending.isEmpty())
+        m_floodTimer.start();
+}
+
+void PKNameResolver::invalidate()
+{
+    m_notFound.clear();
+}
+
+void PKNameResolver::refresh(const QStringList& packageNames)
+{
+    for (const QString &name : packageNames) {
+        if (m_found.remove(name))
+            m_refreshing.insert(name);
+        m_notFound.remove(name);
+    }
+    resolve(packageNames, this, [] {});
+}
+
+void PKNameResolver::start()
+{
+    if (m_transaction || m_pending.isEmpty())
+        return;
+
+    m_inFlight = m_pending;
+    m_pending.clear();
+
+    m_transaction = PackageKit::Daemon::searchNames(m_inFlight.values());
+    connect(m_transaction, &PackageKit::Transaction::package, this, [this](PackageKit::Transaction::Info info, const QString &packageId, const QString &summary) {
+        const QString packageName = PackageKit::Daemon::packageName(packageId);
+        if (m_inFlight.contains(packageName))
+            m_found.insert(packageName);
+        // the ids from the cache are replaced by the first one found
+        if (m_refreshing.remove(packageName))
+            m_backend->clearPackageIds(packageName);
+        m_packageIds += packageId;
+        m_results[packageName] += PKResolvedCache::Package{ info, packageId, summary };
+        m_backend->addPackageArch(info, packageId, summary);
+    });
+    connect(m_transaction, &PackageKit::Transaction::finished, this, &PKNameResolver::transactionFinished, Qt::QueuedConnection);
+}
+
+void PKNameResolver::transactionFinished(PackageKit::Transaction::Exit exit)
+{
+    if (exit == PackageKit::Transaction::ExitSuccess) {
+        for (const QString &name : qAsConst(m_inFlight)) {
+            if (!m_found.contains(name))
+                m_notFound.insert(name);
+            if (m_refreshing.remove(name))
+                m_backend->clearPackageIds(name);
+            m_cache->insert(name, m_results.value(name));
+        }
+    } else {
+        // nothing is remembered, the names will be searched again next time
+        qWarning() << "searchNames failed" << exit;
+    }
+
+    const QSet<QString> done = m_inFlight;
+    const QSet<QString> packageIds = m_packageIds;
+    m_inFlight.clear();
+    m_packageIds.clear();
+    m_results.clear();
+    m_transaction = nullptr;
+    Q_EMIT packagesFound(packageIds);
+
+    // waiters might request more names, so they are only called once the list is updated
+    QVector<Waiter> ready;
+    for (auto it = m_waiters.begin(); it != m_waiters.end();) {
+        it->packageNames -= done;
+        if (it->packageNames.isEmpty()) {
+            ready += *it;
+            it = m_waiters.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    for (const Waiter &waiter : qAsConst(ready)) {
+        if (waiter.context)
+            waiter.done();
+    }
+
+    start();
+}
@@ -0,0 +1,79 @@
+/*
+ *   SPDX-FileCopyrightText: 2021 Wang Rui <wangrui@jingos.com>
+ *   SPDX-License-Identifier: GPL-2.0-only OR GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+ */
+
+#ifndef PKNAMERESOLVER_H
+#define PKNAMERESOLVER_H
+
+#include <QHash>
+#include <QObject>
+#include <QPointer>
+#include <QSet>
+#include <QTimer>
+#include <QVector>
+#include <functional>
+#include <PackageKit/Transaction>
+#include "PKResolvedCache.h"
+
+class PackageKitBackend;
+class PKResolvedCache;
+
+/**
+ * Looks up package names with PackageKit::Daemon::searchNames on behalf of
+ * every result stream.
+ *
+ * Names requested within the same event loop iteration are merged into a
+ * single transaction, names that were already looked up or are being looked
+ * up are not requested again. Only one transaction runs at a time, whatever
+ * comes in meanwhile is sent with the next one.
+ *
+ * Names in the PKResolvedCache are answered from it without a transaction.
+ */
+class PKNameResolver : public QObject
+{
+    Q_OBJECT
+public:
+    PKNameResolver(PackageKitBackend* backend, PKResolvedCache* cache);
+
+    /**
+     * Calls @p done once all @p packageNames have been looked up, unless
+     * @p context has been destroyed by then.
+     */
+    void resolve(const QStringList &packageNames, QObject* context, const std::function<void()> &done);
+
+    /// Forgets about the names that could not be found, so they are searched again
+    void invalidate();
+    /// Searches @p packageNames again, their package ids are replaced by what is found
+    void refresh(const QStringList &packageNames);
+
+Q_SIGNALS:
+    /// Emitted with the ids found by a transaction, before any waiter is called
+    void packagesFound(const QSet<QString> &packageIds);
+
+private:
+    struct Waiter {
+        QPointer<QObject> context;
+        QSet<QString> packageNames;
+        std::function<void()> done;
+    };
+
+    void start();
+    void transactionFinished(PackageKit::Transaction::Exit exit);
+
+    QTimer m_floodTimer;
+    QSet<QString> m_pending;
+    QSet<QString> m_inFlight;
+    QSet<QString> m_found;
+    QSet<QString> m_notFound;
+    QSet<QString> m_packageIds;
+    // what the running transaction found, by name, for the cache
+    QHash<QString, QVector<PKResolvedCache::Package>> m_results;
+    QSet<QString> m_refreshing;
+    QVector<Waiter> m_waiters;
+    QPointer<PackageKit::Transaction> m_transaction;
+    PackageKitBackend* const m_backend;
+    PKResolvedCache* const m_cache;
+};
+
+#endif
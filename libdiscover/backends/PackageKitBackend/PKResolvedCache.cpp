@@ -0,0 +1,167 @@
+/*
+ *   SPDX-FileCopyrightText: 2021 Wang Rui <wangrui@jingos.com>
+ *   SPDX-License-Identifier: GPL-2.0-only OR GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+ */
+
+#include "PKResolvedCache.h"
+
+#include <QDataStream>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+
+#define CACHE_MAGIC 0x43524b50 // "PKRC"
+#define CACHE_VERSION 1
+// the times are computed from "seconds since", two launches can be a bit off
+#define KEY_TOLERANCE 5
+
+PKResolvedCache::PKResolvedCache(const QString &path, QObject *parent)
+    : QObject(parent)
+    , m_path(path)
+{
+    // a startup resolves thousands of names, they are written together
+    m_saveTimer.setInterval(2000);
+    m_saveTimer.setSingleShot(true);
+    connect(&m_saveTimer, &QTimer::timeout, this, &PKResolvedCache::save);
+    load();
+}
+
+PKResolvedCache::~PKResolvedCache()
+{
+    if (m_saveTimer.isActive())
+        save();
+}
+
+bool PKResolvedCache::lookup(const QString &name, QVector<Package> *packages) const
+{
+    auto it = m_packages.constFind(name);
+    if (it == m_packages.constEnd())
+        return false;
+    *packages = *it;
+    return true;
+}
+
+void PKResolvedCache::insert(const QString &name, const QVector<Package> &packages)
+{
+    m_packages.insert(name, packages);
+    m_loadedNames.remove(name);
+    scheduleSave();
+}
+
+QVariantMap PKResolvedCache::details(const QString &packageId) const
+{
+    return m_details.value(packageId);
+}
+
+void PKResolvedCache::insertDetails(const QVariantMap &details)
+{
+    const QString packageId = details.value(QStringLiteral("package-id")).toString();
+    if (packageId.isEmpty())
+        return;
+    m_details.insert(packageId, details);
+    m_loadedDetails.remove(packageId);
+    scheduleSave();
+}
+
+static bool sameKey(const PKResolvedCache::Key &a, const PKResolvedCache::Key &b)
+{
+    if (a.size() != b.size())
+        return false;
+    for (int i = 0; i < a.size(); ++i) {
+        if (qAbs(a[i] - b[i]) > KEY_TOLERANCE)
+            return false;
+    }
+    return true;
+}
+
+QStringList PKResolvedCache::validate(const Key &key)
+{
+    m_validated = true;
+    const QSet<QString> loadedNames = m_loadedNames;
+    const QSet<QString> loadedDetails = m_loadedDetails;
+    m_loadedNames.clear();
+    m_loadedDetails.clear();
+    const bool same = sameKey(key, m_key);
+    m_key = key;
+    if (same) {
+        scheduleSave();
+        return {};
+    }
+
+    // what was looked up since the start is current already
+    for (const QString &name : loadedNames)
+        m_packages.remove(name);
+    for (const QString &packageId : loadedDetails)
+        m_details.remove(packageId);
+    scheduleSave();
+    return loadedNames.values();
+}
+
+void PKResolvedCache::scheduleSave()
+{
+    // nothing is written before it is known what the entries belong to
+    if (m_validated && !m_saveTimer.isActive())
+        m_saveTimer.start();
+}
+
+void PKResolvedCache::load()
+{
+    QFile file(m_path);
+    if (!file.open(QIODevice::ReadOnly))
+        return;
+
+    QDataStream stream(&file);
+    quint32 magic, version;
+    stream >> magic >> version;
+    if (magic != CACHE_MAGIC || version != CACHE_VERSION)
+        return;
+
+    Key key;
+    quint32 count;
+    stream >> key >> count;
+    QHash<QString, QVector<Package>> packages;
+    packages.reserve(count);
+    for (quint32 i = 0; i < count && stream.status() == QDataStream::Ok; ++i) {
+        QString name;
+        quint32 found;
+        stream >> name >> found;
+        QVector<Package> &entry = packages[name];
+        for (quint32 j = 0; j < found && stream.status() == QDataStream::Ok; ++j) {
+            qint32 info;
+            Package package;
+            stream >> info >> package.packageId >> package.summary;
+            package.info = PackageKit::Transaction::Info(info);
+            entry += package;
+        }
+    }
+    QHash<QString, QVariantMap> details;
+    stream >> details;
+    if (stream.status() != QDataStream::Ok)
+        return;
+
+    m_key = key;
+    m_packages = packages;
+    m_details = details;
+    m_loadedNames = QSet<QString>(packages.keyBegin(), packages.keyEnd());
+    m_loadedDetails = QSet<QString>(details.keyBegin(), details.keyEnd());
+}
+
+void PKResolvedCache::save()
+{
+    m_saveTimer.stop();
+    QDir().mkpath(QFileInfo(m_path).absolutePath());
+    QSaveFile file(m_path);
+    if (!file.open(QIODevice::WriteOnly))
+        return;
+
+    QDataStream stream(&file);
+    stream << quint32(CACHE_MAGIC) << quint32(CACHE_VERSION) << m_key << quint32(m_packages.size());
+    for (auto it = m_packages.constBegin(), itEnd = m_packages.constEnd(); it != itEnd; ++it) {
+        stream << it.key() << quint32(it->size());
+        for (const Package &package : *it)
+            stream << qint32(package.info) << package.packageId << package.summary;
+    }
+    stream << m_details;
+    file.commit();
+}
@@ -0,0 +1,78 @@
+/*
+ *   SPDX-FileCopyrightText: 2021 Wang Rui <wangrui@jingos.com>
+ *   SPDX-License-Identifier: GPL-2.0-only OR GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+ */
+
+#ifndef PKRESOLVEDCACHE_H
+#define PKRESOLVEDCACHE_H
+
+#include <QHash>
+#include <QObject>
+#include <QSet>
+#include <QTimer>
+#include <QVariantMap>
+#include <QVector>
+#include <PackageKit/Transaction>
+
+/**
+ * What searchNames and getDetails answered, kept across restarts.
+ *
+ * The entries belong to a key: when PackageKit last refreshed its cache and
+ * last installed, removed or updated packages. On startup the entries are
+ * used right away, before that key is known. Once validate() is given the
+ * current key, entries written for another one are dropped so the caller
+ * can look them up again.
+ */
+class PKResolvedCache : public QObject
+{
+    Q_OBJECT
+public:
+    struct Package {
+        PackageKit::Transaction::Info info;
+        QString packageId;
+        QString summary;
+    };
+    /// seconds since epoch of the PackageKit actions the entries depend on
+    typedef QVector<qint64> Key;
+
+    explicit PKResolvedCache(const QString &path, QObject *parent = nullptr);
+    ~PKResolvedCache() override;
+
+    /**
+     * @returns whether @p name was looked up before. @p packages is filled
+     * with what was found, it stays empty for names that do not exist.
+     */
+    bool lookup(const QString &name, QVector<Package> *packages) const;
+    void insert(const QString &name, const QVector<Package> &packages);
+
+    /// @returns the cached PackageKit::Details of @p packageId, empty if there are none
+    QVariantMap details(const QString &packageId) const;
+    void insertDetails(const QVariantMap &details);
+
+    /**
+     * Sets the key of what PackageKit knows now.
+     * @returns the names read from disk for another key, they are removed
+     */
+    QStringList validate(const Key &key);
+    bool isValidated() const {
+        return m_validated;
+    }
+
+private:
+    void load();
+    void save();
+    void scheduleSave();
+
+    const QString m_path;
+    Key m_key;
+    bool m_validated = false;
+    QHash<QString, QVector<Package>> m_packages;
+    // by package id
+    QHash<QString, QVariantMap> m_details;
+    // read from disk and not looked up again since, until validated
+    QSet<QString> m_loadedNames;
+    QSet<QString> m_loadedDetails;
+    QTimer m_saveTimer;
+};
+
+#endif
@@ -12,6 +12,8 @@
 #include "PKTransaction.h"
 #include "LocalFilePKResource.h"
 #include "PKResolveTransaction.h"
+#include "PKNameResolver.h"
+#include "PKResolvedCache.h"
 #include <resources/AbstractResource.h>
 #include <resources/StandardBackendUpdater.h>
 #include <resources/SourcesModel.h>
@@ -25,7 +27,9 @@
 #include <QFile>
 #include <QAction>
 #include <QMimeDatabase>
+#include <QSharedPointer>
 #include <QFileSystemWatcher>
+#include <QDateTime>
 #include <QFutureWatcher>
 #include <QtConcurrentRun>
 #include <PackageKit/Daemon>
@@ -43,6 +47,11 @@
 #include <QJsonArray>
 #include <QJsonValue>
 #define APPLIST_URL "applist"
+// apps per applist page, the first one fills a screen
+#define APPLIST_PAGE_SIZE 30
+#define RESOLVED_CACHE_FILENAME "/pkresolved.cache"
+// fewer components than this per thread are not worth splitting
+#define APPSTREAM_CHUNK_MIN 2000
 
 
 DISCOVER_BACKEND_PLUGIN(PackageKitBackend)
@@ -99,7 +108,16 @@ PackageKitBackend::PackageKitBackend(QObject* parent)
 
     SourcesModel::global()->addSourcesBackend(new PackageKitSourcesBackend(this));
 
+    m_resolvedCache = new PKResolvedCache(QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + QLatin1String(RESOLVED_CACHE_FILENAME), this);
+    m_nameResolver = new PKNameResolver(this, m_resolvedCache);
+    connect(m_nameResolver, &PKNameResolver::packagesFound, this, [this](const QSet<QString> &packageIds) {
+        getPackagesFinished();
+        if (!packageIds.isEmpty())
+            fetchDetails(packageIds);
+    });
+
     reloadPackageList();
+    validateResolvedCache();
 
     acquireFetching(true);
     setWhenAvailable(PackageKit::Daemon::getTimeSinceAction(PackageKit::Transaction::RoleRefreshCache), [this](uint timeSince) {
@@ -162,26 +180,34 @@ void PackageKitBackend::acquireFetching(bool f)
     Q_ASSERT(m_isFetching>=0);
 }
 
+// the strings come from StringPool, setting them again only copies pointers
+static void setServerData(AbstractResource* res, const ServerData& data)
+{
+    res->setAppId(data.appId);
+    res->setBanner(data.banner);
+    res->setIcon(data.icon);
+    res->setName(data.name);
+    res->setAppName(data.appName);
+    res->setCategoryDisplay(data.categoryDisplay);
+    res->setComment(data.comment);
+}
+
 struct DelayedAppStreamLoad {
     QVector<AppStream::Component> components;
     QHash<QString, AppStream::Component> missingComponents;
+    // built with the components, swapped in as they are
+    QHash<QString, QStringList> packageToApp;
+    QHash<QString, QStringList> extendedBy;
     bool correct = true;
 };
 
-static DelayedAppStreamLoad loadAppStream(AppStream::Pool* appdata)
+static DelayedAppStreamLoad classifyComponents(const QList<AppStream::Component>& components, int from, int count)
 {
     DelayedAppStreamLoad ret;
-
-    ret.correct = appdata->load();
-    if (!ret.correct) {
-        qWarning() << "Could not open the AppStream metadata pool" << appdata->lastError();
-    }
-
-    const auto components = appdata->components();
-    ret.components.reserve(components.size());
-    QSet<QStringList> componentList;
-    foreach (const AppStream::Component& component, components) {
-        componentList.insert(component.packageNames());
+    const int to = qMin(components.size(), from + count);
+    ret.components.reserve(to - from);
+    for (int i = from; i < to; ++i) {
+        const AppStream::Component& component = components.at(i);
         if (component.kind() == AppStream::Component::KindFirmware)
             continue;
 
@@ -196,11 +222,58 @@ static DelayedAppStreamLoad loadAppStream(AppStream::Pool* appdata)
             }
         } else {
             ret.components << component;
+            const QString id = component.id();
+            for (const QString& pkg : pkgNames)
+                ret.packageToApp[pkg] += id;
+            const auto extends = component.extends();
+            for (const QString& pkg : extends)
+                ret.extendedBy[pkg] += id;
         }
     }
     return ret;
 }
 
+template <typename T>
+static void mergeLists(QHash<QString, T>& into, const QHash<QString, T>& from)
+{
+    if (into.isEmpty()) {
+        into = from;
+        return;
+    }
+    for (auto it = from.constBegin(), itEnd = from.constEnd(); it != itEnd; ++it)
+        into[it.key()] += it.value();
+}
+
+static DelayedAppStreamLoad loadAppStream(AppStream::Pool* appdata, QThreadPool* threads)
+{
+    bool correct = appdata->load();
+    if (!correct) {
+        qWarning() << "Could not open the AppStream metadata pool" << appdata->lastError();
+    }
+
+    // the components are classified in chunks on the other threads of the pool
+    const auto components = appdata->components();
+    const int chunks = qBound(1, components.size() / APPSTREAM_CHUNK_MIN, qMax(1, threads->maxThreadCount()));
+    const int chunkSize = (components.size() + chunks - 1) / chunks;
+    QVector<QFuture<DelayedAppStreamLoad>> futures;
+    for (int i = 1; i < chunks; ++i)
+        futures += QtConcurrent::run(threads, &classifyComponents, components, i * chunkSize, chunkSize);
+    DelayedAppStreamLoad ret = classifyComponents(components, 0, chunkSize);
+    ret.correct = correct;
+
+    // not holding a thread of the pool while waiting, the chunks could not start otherwise
+    threads->releaseThread();
+    for (const auto& future : qAsConst(futures)) {
+        const DelayedAppStreamLoad chunk = future.result();
+        ret.components += chunk.components;
+        ret.missingComponents.unite(chunk.missingComponents);
+        mergeLists(ret.packageToApp, chunk.packageToApp);
+        mergeLists(ret.extendedBy, chunk.extendedBy);
+    }
+    threads->reserveThread();
+    return ret;
+}
+
 void PackageKitBackend::loadServerPackageList()
 {
     m_packageServerResourceManager = new PackageServerResourceManager();
@@ -211,7 +284,23 @@ void PackageKitBackend::loadServerPackageList()
 
     connect(m_packageServerResourceManager, &PackageServerResourceManager::loadFinished, this, [this] {
         isLoaded = true;
-        searchPackagekitResources();
+        searchPackagekitResources(m_packageServerResourceManager->m_serverPackageNames);
+    });
+
+    connect(m_packageServerResourceManager, &PackageServerResourceManager::packagesChanged, this,
+            [this](const QStringList &added, const QStringList &changed, const QStringList &/*removed*/) {
+        isLoaded = true;
+        // removed apps are already filtered out by existPackageName, only new ones need resolving
+        for (const QString &appName : changed) {
+            const ServerData data = m_packageServerResourceManager->resourceByName(appName);
+            const auto resources = resourcesByPackageName(appName);
+            for (AbstractResource *res : resources) {
+                setServerData(res, data);
+            }
+        }
+        if (!added.isEmpty()) {
+            searchPackagekitResources(added);
+        }
     });
 
     connect(m_packageServerResourceManager, &PackageServerResourceManager::loadError, this, [this](QString errorStr) {
@@ -221,19 +310,54 @@ void PackageKitBackend::loadServerPackageList()
 
 }
 
-void PackageKitBackend::searchPackagekitResources()
+void PackageKitBackend::validateResolvedCache()
 {
-    PackageKit::Transaction * searchT = PackageKit::Daemon::searchNames(m_packageServerResourceManager->m_serverPackageNames);
-    connect(searchT, &PackageKit::Transaction::package, this, &PackageKitBackend::addPackageForPackageKit);
+    // what the resolved packages depend on, the cache is used meanwhile
+    static const QVector<PackageKit::Transaction::Role> roles = {
+        PackageKit::Transaction::RoleRefreshCache,
+        PackageKit::Transaction::RoleInstallPackages,
+        PackageKit::Transaction::RoleRemovePackages,
+        PackageKit::Transaction::RoleUpdatePackages,
+    };
+    auto key = QSharedPointer<PKResolvedCache::Key>::create(roles.size(), -1);
+    for (int i = 0; i < roles.size(); ++i) {
+        setWhenAvailable(PackageKit::Daemon::getTimeSinceAction(roles[i]), [this, key, i](uint timeSince) {
+            const qint64 now = QDateTime::currentSecsSinceEpoch();
+            // never done is reported as a huge time
+            (*key)[i] = timeSince < now ? now - timeSince : 0;
+            if (key->contains(-1))
+                return;
+
+            const QStringList stale = m_resolvedCache->validate(*key);
+            if (!stale.isEmpty()) {
+                qCDebug(LIBDISCOVER_BACKEND_LOG) << "resolved packages cache is stale, looking up" << stale.count() << "names again";
+                m_nameResolver->refresh(stale);
+            }
+        }, this);
+    }
+}
 
-    connect(searchT, &PackageKit::Transaction::finished, this, [this](PackageKit::Transaction::Exit status) {
-        getPackagesFinished();
-    }, Qt::QueuedConnection);
+void PackageKitBackend::clearPackageIds(const QString& packageName)
+{
+    const auto resources = resourcesByPackageName(packageName);
+    for (AbstractResource* res : resources) {
+        const auto oldState = res->state();
+        static_cast<PackageKitResource*>(res)->clearPackageIds();
+        if (oldState != res->state())
+            Q_EMIT res->stateChanged();
+    }
+}
+
+void PackageKitBackend::searchPackagekitResources(const QStringList &packageNames)
+{
+    m_nameResolver->resolve(packageNames, this, [] {});
 }
 
 void PackageKitBackend::reloadPackageList()
 {
     acquireFetching(true);
+    // the repositories might have changed, names that were missing could be there now
+    m_nameResolver->invalidate();
     if (m_refresher) {
         disconnect(m_refresher.data(), &PackageKit::Transaction::finished, this, &PackageKitBackend::reloadPackageList);
     }
@@ -242,7 +366,7 @@ void PackageKitBackend::reloadPackageList()
 
     auto fw = new QFutureWatcher<DelayedAppStreamLoad>(this);
     connect(fw, &QFutureWatcher<DelayedAppStreamLoad>::finished, this, [this, fw]() {
-        const auto data = fw->result();
+        auto data = fw->result();
         fw->deleteLater();
 
         if (!data.correct && m_packages.packages.isEmpty()) {
@@ -250,10 +374,13 @@ void PackageKitBackend::reloadPackageList()
                 Q_EMIT passiveMessage(i18n("Please make sure that Appstream is properly set up on your system"));
             });
         }
-        for (const auto &component: data.components) {
-            const auto pkgNames = component.packageNames();
-            addComponent(component, pkgNames);
+        // only the resources are made here, the tables were built along with the components
+        m_packages.packages.reserve(m_packages.packages.size() + data.components.size());
+        for (const auto &component: qAsConst(data.components)) {
+            addComponent(component);
         }
+        m_packages.packageToApp.swap(data.packageToApp);
+        m_packages.extendedBy.swap(data.extendedBy);
 
         if (data.components.isEmpty()) {
             qCDebug(LIBDISCOVER_BACKEND_LOG) << "empty appstream db";
@@ -267,12 +394,13 @@ void PackageKitBackend::reloadPackageList()
         }
         acquireFetching(false);
     });
-    fw->setFuture(QtConcurrent::run(&m_threadPool, &loadAppStream, m_appdata.get()));
+    fw->setFuture(QtConcurrent::run(&m_threadPool, &loadAppStream, m_appdata.get(), &m_threadPool));
 }
 
-AppPackageKitResource* PackageKitBackend::addComponent(const AppStream::Component& component, const QStringList& pkgNames)
+AppPackageKitResource* PackageKitBackend::addComponent(const AppStream::Component& component)
 {
     Q_ASSERT(isFetching());
+    const auto pkgNames = component.packageNames();
     Q_ASSERT(!pkgNames.isEmpty());
     auto& resPos = m_packages.packages[component.id()];
     AppPackageKitResource* res = qobject_cast<AppPackageKitResource*>(resPos);
@@ -282,13 +410,6 @@ AppPackageKitResource* PackageKitBackend::addComponent(const AppStream::Componen
     } else {
         res->clearPackageIds();
     }
-    foreach (const QString& pkg, pkgNames) {
-        m_packages.packageToApp[pkg] += component.id();
-    }
-
-    foreach (const QString& pkg, component.extends()) {
-        m_packages.extendedBy[pkg] += res;
-    }
     return res;
 }
 
@@ -322,12 +443,6 @@ void PackageKitBackend::fetchUpdates()
     Q_EMIT fetchingUpdatesProgressChanged();
 }
 
-void PackageKitBackend::addPackageForPackageKit(PackageKit::Transaction::Info info, const QString& packageId, const QString& summary)
-{
-    m_packageKitId += packageId;
-    addPackage(info, packageId, summary, true);
-}
-
 void PackageKitBackend::addPackageArch(PackageKit::Transaction::Info info, const QString& packageId, const QString& summary)
 {
     addPackage(info, packageId, summary, true);
@@ -362,9 +477,6 @@ void PackageKitBackend::addPackage(PackageKit::Transaction::Info info, const QSt
 void PackageKitBackend::getPackagesFinished()
 {
     includePackagesToAdd();
-    if (m_packageKitId.size() > 0) {
-        fetchDetails(m_packageKitId);
-    }
     emit updatesCountChanged();
 }
 
@@ -385,7 +497,7 @@ void PackageKitBackend::includePackagesToAdd()
                 if (AppPackageKitResource* ares = qobject_cast<AppPackageKitResource*>(res)) {
                     const auto extends = res->extends();
                     for (const auto &ext: extends)
-                        m_packages.extendedBy[ext].removeAll(ares);
+                        m_packages.extendedBy[ext].removeAll(ares->appstreamId());
                 }
 
                 emit resourceRemoved(res);
@@ -405,6 +517,12 @@ void PackageKitBackend::transactionError(PackageKit::Transaction::Error, const Q
 }
 
 void PackageKitBackend::packageDetails(const PackageKit::Details& details)
+{
+    m_resolvedCache->insertDetails(details);
+    applyDetails(details);
+}
+
+void PackageKitBackend::applyDetails(const PackageKit::Details& details)
 {
     const QSet<AbstractResource*> resources = resourcesByPackageName(PackageKit::Daemon::packageName(details.packageId()));
     if (resources.isEmpty())
@@ -507,8 +625,20 @@ public:
         }));
         Q_EMIT resourcesFound(res);
     }
+
+    // where the app list continues, see PackageKitBackend::fetchAppListPage()
+    QString nextCursor() const
+    {
+        return m_nextCursor;
+    }
+
+    void setNextCursor(const QString &cursor)
+    {
+        m_nextCursor = cursor;
+    }
 private:
     PackageKitBackend* const backend;
+    QString m_nextCursor;
 };
 
 ResultsStream* PackageKitBackend::search(const AbstractResourcesBackend::Filters& filter)
@@ -518,7 +648,7 @@ ResultsStream* PackageKitBackend::search(const AbstractResourcesBackend::Filters
     } else if (!filter.extends.isEmpty()) {
         auto stream = new PKResultsStream(this, QStringLiteral("PackageKitStream-extends"));
         auto f = [this, filter, stream] {
-            const auto resources = kTransform<QVector<AbstractResource*>>(m_packages.extendedBy.value(filter.extends), [](AppPackageKitResource* a) {
+            const auto resources = kTransform<QVector<AbstractResource*>>(extendedBy(filter.extends), [](AppPackageKitResource* a) {
                 return a;
             });
             if (!resources.isEmpty()) {
@@ -657,6 +787,7 @@ void PackageKitBackend::runWhenLoadedCache(const std::function<void ()>& f, QObj
 {
     disconnect(ec);
     disconnect(sc);
+    disconnect(cc);
     auto onErrored = [this,f,stream] {
         runWhenInitialized(f, stream);
     };
@@ -665,6 +796,7 @@ void PackageKitBackend::runWhenLoadedCache(const std::function<void ()>& f, QObj
     };
     sc = connect(m_packageServerResourceManager, &PackageServerResourceManager::loadFinished, this,onFinished);
     ec = connect(m_packageServerResourceManager, &PackageServerResourceManager::loadError, this, onErrored);
+    cc = connect(m_packageServerResourceManager, &PackageServerResourceManager::packagesChanged, this, onFinished);
 }
 
 PKResultsStream * PackageKitBackend::findResourceByPackageName(const QUrl& url)
@@ -879,12 +1011,21 @@ void PackageKitBackend::fetchDetails(const QSet<QString>& pkgid)
 void PackageKitBackend::performDetailsFetch()
 {
     Q_ASSERT(!m_packageNamesToFetchDetails.isEmpty());
-    const auto ids = m_packageNamesToFetchDetails.values();
+    QStringList ids;
+    for (const QString& id : qAsConst(m_packageNamesToFetchDetails)) {
+        const QVariantMap cached = m_resolvedCache->details(id);
+        if (cached.isEmpty())
+            ids += id;
+        else
+            applyDetails(PackageKit::Details(cached));
+    }
+    m_packageNamesToFetchDetails.clear();
+    if (ids.isEmpty())
+        return;
 
     PackageKit::Transaction* transaction = PackageKit::Daemon::getDetails(ids);
     connect(transaction, &PackageKit::Transaction::details, this, &PackageKitBackend::packageDetails);
     connect(transaction, &PackageKit::Transaction::errorCode, this, &PackageKitBackend::transactionError);
-    m_packageNamesToFetchDetails.clear();
 }
 
 void PackageKitBackend::checkDaemonRunning()
@@ -902,7 +1043,13 @@ AbstractBackendUpdater* PackageKitBackend::backendUpdater() const
 
 QVector<AppPackageKitResource*> PackageKitBackend::extendedBy(const QString& id) const
 {
-    return m_packages.extendedBy[id];
+    QVector<AppPackageKitResource*> ret;
+    const QStringList ids = m_packages.extendedBy.value(id);
+    for (const QString& componentId : ids) {
+        if (auto res = qobject_cast<AppPackageKitResource*>(m_packages.packages.value(componentId)))
+            ret += res;
+    }
+    return ret;
 }
 
 AbstractReviewsBackend* PackageKitBackend::reviewsBackend() const
@@ -951,13 +1098,7 @@ void PackageKitBackend::loadLocalPackageData(QString category,QString keyword,PK
         }
         QList<AbstractResource*> listResources = originResource.values();
         foreach (AbstractResource* listItem, listResources) {
-            listItem->setAppId(itemData.appId);
-            listItem->setBanner(itemData.banner);
-            listItem->setIcon(itemData.icon);
-            listItem->setName(itemData.name);
-            listItem->setAppName(itemData.appName);
-            listItem->setCategoryDisplay(itemData.categoryDisplay);
-            listItem->setComment(itemData.comment);
+            setServerData(listItem, itemData);
             localdisplayRes.append(listItem);
         }
     }
@@ -967,189 +1108,144 @@ void PackageKitBackend::loadLocalPackageData(QString category,QString keyword,PK
         return;
     }
     stream->setResources(localdisplayRes);
-    m_packageKitId.clear();
-
-    PackageKit::Transaction * searchT = PackageKit::Daemon::searchNames(notFindResources);
-    connect(searchT, &PackageKit::Transaction::package, this, &PackageKitBackend::addPackageForPackageKit);
 
-    connect(searchT,&PackageKit::Transaction::errorCode,this,[this,stream] {
-        stream->finish();
-    });
-    connect(searchT, &PackageKit::Transaction::finished, this, [this,stream,notFindResources](PackageKit::Transaction::Exit status) {
-        getPackagesFinished();
-        if (status == PackageKit::Transaction::Exit::ExitSuccess) {
-            QVector<AbstractResource*> displayRes;
+    m_nameResolver->resolve(notFindResources, stream, [this,stream,notFindResources] {
+        QVector<AbstractResource*> displayRes;
 
-            foreach (QString pkgname,notFindResources) {
-                ServerData pkgVaule = m_packageServerResourceManager->resourceByName(pkgname);
-                QSet<AbstractResource*> res = resourcesByPackageName(pkgname);
-                if (res.count() > 0) {
-                    AbstractResource* getResource = res.values().first();
-                    getResource->setAppId(pkgVaule.appId);
-                    getResource->setBanner(pkgVaule.banner);
-                    getResource->setIcon(pkgVaule.icon);
-                    getResource->setName(pkgVaule.name);
-                    getResource->setAppName(pkgVaule.appName);
-                    getResource->setCategoryDisplay(pkgVaule.categoryDisplay);
-                    getResource->setComment(pkgVaule.comment);
-                    displayRes.append(getResource);
-                }
+        foreach (QString pkgname,notFindResources) {
+            ServerData pkgVaule = m_packageServerResourceManager->resourceByName(pkgname);
+            QSet<AbstractResource*> res = resourcesByPackageName(pkgname);
+            if (res.count() > 0) {
+                AbstractResource* getResource = res.values().first();
+                setServerData(getResource, pkgVaule);
+                displayRes.append(getResource);
             }
-            stream->setResources(displayRes);
-            stream->finish();
         }
-    }, Qt::QueuedConnection);
+        stream->setResources(displayRes);
+        stream->finish();
+    });
 }
 
 ResultsStream *PackageKitBackend::getAppList(QString category,QString keyword,PKResultsStream *stream)
 {
-    QString url;
-    url = QLatin1String(BASE_URL) + QLatin1String(APPLIST_URL);
-    QString requestParam = QLatin1String("category");
-    if (category == QLatin1String("feature_applications")) {
-        requestParam = "label";
-        category = "recommend";
+    // offline the catalog snapshot and its search index answer instead of the server,
+    // the results are marked stale so that they get refreshed once back online
+    const bool offline = PackageKit::Daemon::networkState() == PackageKit::Daemon::NetworkOffline;
+    if (offline && keyword != "") {
+        stream->markStale();
+        loadLocalPackageData(category, keyword, stream);
+        return stream;
+    }
 
+    AppListQuery query;
+    query.localCategory = category;
+    query.localKeyword = keyword;
+    query.offline = offline;
+    query.param = QLatin1String("category");
+    query.value = category;
+    if (category == QLatin1String("feature_applications")) {
+        query.param = "label";
+        query.value = "recommend";
     }
-//    else {
-//        loadLocalPackageData(category,keyword,stream);
-//    }
     if (keyword != "") {
-        requestParam = "keyword";
-        category = keyword;
+        query.param = "keyword";
+        query.value = keyword;
     }
-    HttpClient::global() -> get(url)
-    .header(QString::fromUtf8("content-type"), QString::fromUtf8("application/json"))
-    .queryParam(requestParam, category)
-    .onResponse([this,stream](QByteArray result) {
-        auto json = QJsonDocument::fromJson(result).object();
-        if (json.empty()) {
-            stream->finish();
+
+    // the next page is only asked for once the view scrolls close to the end
+    connect(stream, &ResultsStream::fetchMore, this, [this, stream, query] {
+        if (!stream->isWaitingForMore())
             return;
-        }
-        auto httpCode = json.value(QString::fromUtf8("code")).toInt();
-        if (httpCode != 200) {
+        stream->setWaitingForMore(false);
+        fetchAppListPage(query, stream->nextCursor(), stream);
+    });
+    fetchAppListPage(query, QString(), stream);
+    return stream;
+}
+
+void PackageKitBackend::fetchAppListPage(const AppListQuery &query, const QString &cursor, PKResultsStream *stream)
+{
+    // once the page is shown, the stream is over or waits to be asked for the next one
+    const auto pageShown = [stream](const QString &nextCursor) {
+        if (nextCursor.isEmpty()) {
             stream->finish();
-            return;
+        } else {
+            stream->setNextCursor(nextCursor);
+            stream->setWaitingForMore(true);
+        }
+    };
+
+    HttpRequest request = HttpClient::global() -> get(QLatin1String(BASE_URL) + QLatin1String(APPLIST_URL));
+    request.header(QString::fromUtf8("content-type"), QString::fromUtf8("application/json"))
+    .queryParam(query.param, query.value)
+    .queryParam(QStringLiteral("limit"), QString::number(APPLIST_PAGE_SIZE));
+    if (!cursor.isEmpty()) {
+        request.queryParam(QStringLiteral("cursor"), cursor);
+    }
+    request
+    // the page may still be in the http cache, it knows the featured apps the snapshot does not
+    .cachePolicy(query.offline ? HttpRequest::CacheOnly : query.localKeyword.isEmpty() ? HttpRequest::StaleWhileRevalidate : HttpRequest::NetworkFirst)
+    // what the user waits for, a slow answer is asked for a second time
+    .hedged()
+    .onDecoded(stream, &PackageServerResourceManager::decodeAppList, [this,stream,query,pageShown](const ServerAppPage &page) {
+        if (query.offline) {
+            stream->markStale();
         }
-        auto appList = json.value(QString::fromUtf8("apps")).toArray();
-        if (appList.size() < 1) {
+        const QVector<ServerData> &appList = page.apps;
+        if (appList.isEmpty()) {
             stream->finish();
             return;
         }
         QStringList notResources;
         QHash<QString,ServerData> cacheRequest;
         QVector<AbstractResource*> displayRes;
-        for (int i = 0; i < appList.size(); i++) {
-            auto appObj = appList.at(i).toObject();
-            auto appId = appObj.value(QString::fromUtf8("appId")).toString();
-            auto appName = appObj.value(QString::fromUtf8("appName")).toString();
-            auto icon = appObj.value(QString::fromUtf8("icon")).toString();
-            auto banner = appObj.value(QString::fromUtf8("banner")).toString();
-            auto categories = appObj.value(QString::fromUtf8("categories")).toArray();
-            auto display = appObj.value(QString::fromUtf8("display")).toArray();
-            auto resource = m_packages.packages.value(appName);
-//            AbstractResource* resource = nullptr;
-//            QSet<AbstractResource*> res = resourcesByPackageName(appName);
-//            if (res.count() > 0) {
-//                resource = res.values().first();
-//            }
-            QString name = "";
-            QString comment = "";
-            for (int j = 0; j < display.size(); j++) {
-                auto displayObj = display.at(j).toObject();
-                QString lang = "";
-                if (QLocale::system().bcp47Name().startsWith("zh")) {
-                    lang = "cn";
-                } else {
-                    lang = "en";
-                }
-                if (lang == displayObj.value(QString::fromUtf8("lang")).toString()) {
-                    name = displayObj.value(QString::fromUtf8("name")).toString();
-                    comment = displayObj.value(QString::fromUtf8("summary")).toString();
-                }
-            }
-            QString categoryDisplay = "";
-            for (int j = 0; j < categories.size(); j++) {
-                categoryDisplay += categories.at(j).toString();
-                if (j != categories.size() - 1) {
-                    categoryDisplay += ",";
-                }
-            }
+        for (const ServerData &currentData : appList) {
+            auto resource = m_packages.packages.value(currentData.appName);
             if (resource) {
-                resource->setAppId(appId);
-                resource->setBanner(banner);
-                resource->setIcon(icon);
-                resource->setName(name);
-                resource->setAppName(appName);
-                resource->setCategoryDisplay(categoryDisplay);
-                resource->setComment(comment);
+                setServerData(resource, currentData);
                 displayRes.append(resource);
             } else {
-                ServerData currentData;
-                currentData.appId = appId;
-                currentData.banner = banner;
-                currentData.categoryDisplay = categoryDisplay;
-                currentData.comment = comment;
-                currentData.icon = icon;
-                currentData.name = name;
-                currentData.appName = appName;
-                notResources.append(appName);
-                cacheRequest.insert(appName,currentData);
+                notResources.append(currentData.appName);
+                cacheRequest.insert(currentData.appName,currentData);
             }
         }
         if (notResources.size() <= 0) {
             stream->setResources(displayRes);
-            stream->finish();
+            pageShown(page.nextCursor);
             return;
         }
         stream->setResources(displayRes);
-        m_packageKitId.clear();
-        //,PackageKit::Transaction::FilterApplication
-        PackageKit::Transaction * searchT = PackageKit::Daemon::searchNames(notResources);
-        connect(searchT, &PackageKit::Transaction::package, this, &PackageKitBackend::addPackageForPackageKit);
+        const QString nextCursor = page.nextCursor;
+        m_nameResolver->resolve(notResources, stream, [this,stream,cacheRequest,pageShown,nextCursor] {
+            QVector<AbstractResource*> displayRes;
 
-        connect(searchT,&PackageKit::Transaction::errorCode,this,[this,stream] {
-            stream->finish();
-        });
-        connect(searchT, &PackageKit::Transaction::finished, this, [this,stream,cacheRequest,notResources](PackageKit::Transaction::Exit status) {
-            getPackagesFinished();
-            if (status == PackageKit::Transaction::Exit::ExitSuccess) {
-                QVector<AbstractResource*> displayRes;
-
-                for (auto it = cacheRequest.constBegin(), itEnd = cacheRequest.constEnd(); it != itEnd; ++it) {
-                    QString pkgKey = it.key();
-                    ServerData pkgVaule = it.value();
-                    QSet<AbstractResource*> res = resourcesByPackageName(pkgKey);
-                    if (res.count() > 0) {
-                        AbstractResource* getResource = res.values().first();
-                        getResource->setAppId(pkgVaule.appId);
-                        getResource->setBanner(pkgVaule.banner);
-                        getResource->setIcon(pkgVaule.icon);
-                        getResource->setName(pkgVaule.name);
-                        getResource->setAppName(pkgVaule.appName);
-                        getResource->setCategoryDisplay(pkgVaule.categoryDisplay);
-                        getResource->setComment(pkgVaule.comment);
-                        displayRes.append(getResource);
-                    }
+            for (auto it = cacheRequest.constBegin(), itEnd = cacheRequest.constEnd(); it != itEnd; ++it) {
+                QString pkgKey = it.key();
+                ServerData pkgVaule = it.value();
+                QSet<AbstractResource*> res = resourcesByPackageName(pkgKey);
+                if (res.count() > 0) {
+                    AbstractResource* getResource = res.values().first();
+                    setServerData(getResource, pkgVaule);
+                    displayRes.append(getResource);
                 }
-                stream->setResources(displayRes);
-                stream->finish();
             }
-        }, Qt::QueuedConnection);
+            stream->setResources(displayRes);
+            pageShown(nextCursor);
+        });
 
     })
-    .onError([this,stream](QString errorStr) {
-        stream->finish();
+    .onError([this,stream,query,cursor](QString errorStr) {
         qDebug()<<Q_FUNC_INFO << " busy onError:" << errorStr;
-
-        return;
+        if (!cursor.isEmpty()) {
+            // what was shown stays, scrolling to the end asks for the page again
+            stream->setWaitingForMore(true);
+            return;
+        }
+        stream->markStale();
+        loadLocalPackageData(query.localCategory, query.localKeyword, stream);
     })
     .timeout(10 * 1000)
     .exec();
-
-
-    return stream;
 }
 
 #include "PackageKitBackend.moc"
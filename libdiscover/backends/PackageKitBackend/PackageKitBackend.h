@@ -28,6 +28,8 @@ class PackageKitUpdater;
 class OdrsReviewsBackend;
 class PKResultsStream;
 class PKResolveTransaction;
+class PKNameResolver;
+class PKResolvedCache;
 
 class DISCOVERCOMMON_EXPORT PackageKitBackend : public AbstractResourcesBackend
 {
@@ -79,7 +81,8 @@ public:
 
     void addPackageArch(PackageKit::Transaction::Info info, const QString &packageId, const QString &summary);
     void addPackageNotArch(PackageKit::Transaction::Info info, const QString &packageId, const QString &summary);
-    void addPackageForPackageKit(PackageKit::Transaction::Info info, const QString &packageId, const QString &summary);
+    /// Forgets the package ids of @p packageName, before they are looked up again
+    void clearPackageIds(const QString& packageName);
 
 
 public Q_SLOTS:
@@ -91,6 +94,7 @@ private Q_SLOTS:
     void getPackagesFinished();
     void addPackage(PackageKit::Transaction::Info info, const QString &packageId, const QString &summary, bool arch);
     void packageDetails(const PackageKit::Details& details);
+    void applyDetails(const PackageKit::Details& details);
     void addPackageToUpdate(PackageKit::Transaction::Info, const QString& pkgid, const QString& summary);
     void getUpdatesFinished(PackageKit::Transaction::Exit,uint);
 
@@ -110,11 +114,21 @@ private:
     void acquireFetching(bool f);
     void includePackagesToAdd();
     void performDetailsFetch();
+    /// the parameters of an applist request, the same for all of its pages
+    struct AppListQuery {
+        QString param;
+        QString value;
+        QString localCategory;
+        QString localKeyword;
+        bool offline = false;
+    };
     ResultsStream *getAppList(QString category,QString keyword,PKResultsStream * stream);
+    void fetchAppListPage(const AppListQuery &query, const QString &cursor, PKResultsStream *stream);
     void loadLocalPackageData(QString category,QString keyword,PKResultsStream *stream);
-    void searchPackagekitResources();
+    void searchPackagekitResources(const QStringList &packageNames);
+    void validateResolvedCache();
     void showResource();
-    AppPackageKitResource* addComponent(const AppStream::Component& component, const QStringList& pkgNames);
+    AppPackageKitResource* addComponent(const AppStream::Component& component);
     void updateProxy();
 
     QScopedPointer<AppStream::Pool> m_appdata;
@@ -122,7 +136,6 @@ private:
     QPointer<PackageKit::Transaction> m_refresher;
     int m_isFetching;
     QSet<QString> m_updatesPackageId;
-    QSet<QString> m_packageKitId;
     bool m_hasSecurityUpdates = false;
     QSet<PackageKitResource*> m_packagesToAdd;
     QSet<PackageKitResource*> m_packagesToDelete;
@@ -131,7 +144,8 @@ private:
     struct {
         QHash<QString, AbstractResource*> packages;
         QHash<QString, QStringList> packageToApp;
-        QHash<QString, QVector<AppPackageKitResource*>> extendedBy;
+        // by the package they extend, the ids of the components extending it
+        QHash<QString, QStringList> extendedBy;
         QHash<QString, AbstractResource*> installsApplications;
     } m_packages;
 
@@ -151,10 +165,13 @@ private:
     QPointer<PackageKit::Transaction> m_getUpdatesTransaction;
     QThreadPool m_threadPool;
     QPointer<PKResolveTransaction> m_resolveTransaction;
+    PKNameResolver* m_nameResolver;
+    PKResolvedCache* m_resolvedCache;
     PackageServerResourceManager* m_packageServerResourceManager;
     bool isLoaded = false;
     QMetaObject::Connection ec;
     QMetaObject::Connection sc;
+    QMetaObject::Connection cc;
 
 };
 
@@ -1,20 +1,28 @@
 #include "packageserverresourcemanager.h"
 #include "network/HttpClient.h"
+#include "resources/StringPool.h"
 #include <QJsonDocument>
 #include <QJsonArray>
+#include <QJsonObject>
 #include <QNetworkReply>
 #include <QFutureWatcher>
 #include <QtConcurrent>
 #include <QList>
+#include <QCryptographicHash>
+#include <algorithm>
 
 #define IF_MODIFIED_SINCE "If-Modified-Since"
 #define IF_NONE_MATCH "If-None-Match"
 #define LAST_MODIFIED "Last-Modified"
 #define ETAG "Etag"
 #define CACHE_FILENAME "/allAppinfo.json"
+#define INDEX_FILENAME "/allAppinfo.index"
+#define SNAPSHOT_FILENAME "/allAppinfo.snapshot"
 
 PackageServerResourceManager::PackageServerResourceManager(QObject *parent) : QObject(parent)
 {
+    // the catalog, the snapshot and the index on disk are written one job after another, in order
+    m_writePool.setMaxThreadCount(1);
     m_requestDataTimer.setSingleShot(true);
     connect(&m_requestDataTimer, &QTimer::timeout, this, &PackageServerResourceManager::requestData);
 }
@@ -23,6 +31,8 @@ PackageServerResourceManager::~PackageServerResourceManager()
 {
     m_threadPool.waitForDone(200);
     m_threadPool.clear();
+    // what is queued is already known, the next start should not have to download it again
+    m_writePool.waitForDone();
 }
 
 static QByteArray startLoad() {
@@ -40,21 +50,146 @@ static QByteArray startLoad() {
     return ret;
 }
 
+static ServerData serverDataFromJson(const QJsonObject &appObj)
+{
+    auto categories = appObj.value(QString::fromUtf8("categories")).toArray();
+    auto display = appObj.value(QString::fromUtf8("display")).toArray();
+    QString name = "";
+    QString comment = "";
+    for (int j = 0; j < display.size(); j++) {
+        auto displayObj = display.at(j).toObject();
+        QString lang = "";
+        if (QLocale::system().bcp47Name().startsWith("zh")) {
+            lang = "cn";
+        } else {
+            lang = "en";
+        }
+        if (lang == displayObj.value(QString::fromUtf8("lang")).toString()) {
+            name = displayObj.value(QString::fromUtf8("name")).toString();
+            comment = displayObj.value(QString::fromUtf8("summary")).toString();
+        }
+    }
+    QString categoryDisplay = "";
+    QSet<QString> categoriesSets;
+    for (int j = 0; j < categories.size(); j++) {
+        QString currentType = categories.at(j).toString();
+        categoryDisplay += currentType;
+        categoriesSets.insert(StringPool::global()->intern(currentType));
+        if (j != categories.size() - 1) {
+            categoryDisplay += ",";
+        }
+    }
+    // every request decodes the same apps again, they all share the strings of the first one
+    StringPool *pool = StringPool::global();
+    ServerData currentData;
+    currentData.appId = pool->intern(appObj.value(QString::fromUtf8("appId")).toString());
+    currentData.banner = pool->intern(appObj.value(QString::fromUtf8("banner")).toString());
+    currentData.categoryDisplay = pool->intern(categoryDisplay);
+    currentData.comment = pool->intern(comment);
+    currentData.icon = pool->intern(appObj.value(QString::fromUtf8("icon")).toString());
+    currentData.name = pool->intern(name);
+    currentData.appName = pool->intern(appObj.value(QString::fromUtf8("appName")).toString());
+    currentData.categoriesSet = categoriesSets;
+    return currentData;
+}
+
+static void writeSnapshotFile(const QString &cacheDir, const QVector<ServerData> &records, const QByteArray &checksum, const QString &version)
+{
+    const QString path = cacheDir + QLatin1String(SNAPSHOT_FILENAME);
+    if (!PackageServerSnapshot::write(path, records, QFileInfo(cacheDir + QLatin1String(CACHE_FILENAME)), checksum, version)) {
+        qWarning() << "could not write the catalog snapshot to" << path;
+    }
+}
+
+// Applies a delta to the cached JSON document so the next full parse sees the same catalog
+static QByteArray mergeCatalog(const QString &path, const QJsonArray &apps, const QSet<QString> &removed, const QString &version)
+{
+    QFile app_json(path);
+    if (!app_json.open(QIODevice::ReadWrite)) {
+        return {};
+    }
+    QJsonObject catalog = QJsonDocument::fromJson(app_json.readAll()).object();
+
+    QHash<QString, QJsonValue> updated;
+    for (const QJsonValue &app : apps) {
+        updated.insert(app.toObject().value(QString::fromUtf8("appName")).toString(), app);
+    }
+    QJsonArray merged;
+    const QJsonArray current = catalog.value(QString::fromUtf8("apps")).toArray();
+    for (const QJsonValue &app : current) {
+        const QString appName = app.toObject().value(QString::fromUtf8("appName")).toString();
+        if (removed.contains(appName)) {
+            continue;
+        }
+        const auto it = updated.find(appName);
+        if (it == updated.end()) {
+            merged += app;
+        } else {
+            merged += *it;
+            updated.erase(it);
+        }
+    }
+    // whatever was not replaced is new
+    for (const QJsonValue &app : apps) {
+        if (updated.contains(app.toObject().value(QString::fromUtf8("appName")).toString())) {
+            merged += app;
+        }
+    }
+    catalog.insert(QString::fromUtf8("apps"), merged);
+    catalog.insert(QString::fromUtf8("version"), version);
+
+    const QByteArray jsonData = QJsonDocument(catalog).toJson(QJsonDocument::Compact);
+    app_json.resize(0);
+    app_json.write(jsonData);
+    app_json.close();
+    return jsonData;
+}
+
+// Replaces the cached JSON document, @returns false when it already had these contents
+static bool storeCatalog(const QString &path, const QByteArray &jsonData)
+{
+    QFile app_json(path);
+    if (!app_json.open(QIODevice::ReadWrite)) {
+        return false;
+    }
+    if (app_json.readAll() == jsonData) {
+        return false;
+    }
+    app_json.resize(0);
+    app_json.write(jsonData);
+    app_json.close();
+    return true;
+}
+
 void PackageServerResourceManager::loadCacheData()
 {
-    auto fw = new QFutureWatcher<QByteArray>(this);
-    connect(fw, &QFutureWatcher<QByteArray>::finished, this, [this, fw]() {
-        const auto data = fw->result();
+    if (openSnapshot()) {
+        // records are read from the mapping on demand, there is nothing to parse
+        isCacheData = true;
+        QTimer::singleShot(0, this, [this] {
+            emit loadFinished();
+            m_requestDataTimer.start();
+        });
+        emit loadStart();
+        return;
+    }
+
+    auto fw = new QFutureWatcher<ServerCatalog>(this);
+    connect(fw, &QFutureWatcher<ServerCatalog>::finished, this, [this, fw]() {
+        const ServerCatalog catalog = fw->result();
         fw->deleteLater();
-        if (!data.isEmpty()) {
+        if (catalog.valid) {
             isCacheData = true;
-            parseJson(data);
+            setCatalog(catalog);
+            writeSnapshot();
             emit loadFinished();
         }
         m_requestDataTimer.start();
 
     });
-    fw->setFuture(QtConcurrent::run(&m_threadPool, &startLoad));
+    fw->setFuture(QtConcurrent::run(&m_threadPool, [] {
+        return decodeCatalog(startLoad());
+    }));
     emit loadStart();
 }
 
@@ -62,7 +197,6 @@ void PackageServerResourceManager::requestData()
 {
     QString url;
     url = QLatin1String(BASE_URL) + QLatin1String("allapp");
-//    QString requestParam = QLatin1String("versionId");
 
     if (lastModified != "") {
         headers.insert(IF_MODIFIED_SINCE,lastModified);
@@ -70,7 +204,14 @@ void PackageServerResourceManager::requestData()
     if (etag != "") {
         headers.insert(IF_NONE_MATCH,etag);
     }
-    HttpClient::global() -> get(url)
+    auto request = HttpClient::global() -> get(url);
+    if (versionId != "") {
+        // the server answers with only what changed since this version
+        request.queryParam(QString::fromUtf8("versionId"), versionId);
+    }
+    // versioned by the server already, a second copy of the catalog is not worth keeping
+    request.cachePolicy(HttpRequest::NoCache)
+    .priority(HttpRequest::Background)
     .headers(headers)
     .onResponse([this](QNetworkReply* result) {
         bool isExistETAG = result->hasRawHeader(ETAG);
@@ -78,114 +219,265 @@ void PackageServerResourceManager::requestData()
             etag = result->rawHeader(ETAG);
             lastModified = result->rawHeader(LAST_MODIFIED);
         }
-        QByteArray serverData = result->readAll();
+        const QByteArray serverData = result->readAll();
 
-        auto json = QJsonDocument::fromJson(serverData).object();
-        if (json.empty()) {
-            emit loadError("data is null");
-            return;
-        }
-        auto httpCode = json.value(QString::fromUtf8("code")).toInt();
-        if (httpCode == 204) {
-            emit loadFinished();
-            return;
-        }
-        auto appList = json.value(QString::fromUtf8("apps")).toArray();
-        if (appList.size() < 1) {
-            emit loadError("data size is empty");
-            return;
-        }
-        parseJson(serverData);
-
-        QString path = QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + QLatin1String(CACHE_FILENAME);
-        QFile app_json(path);
-        if (app_json.open(QIODevice::ReadWrite)) {
-            QByteArray fileData =  app_json.readAll();
-            if (serverData == fileData) {
-                return;
+        // a full catalog is several megabytes, it is parsed and stored away from the GUI thread,
+        // after whatever the previous catalog still had to write
+        const QString path = QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + QLatin1String(CACHE_FILENAME);
+        auto fw = new QFutureWatcher<ServerCatalog>(this);
+        connect(fw, &QFutureWatcher<ServerCatalog>::finished, this, [this, fw]() {
+            const ServerCatalog catalog = fw->result();
+            fw->deleteLater();
+            catalogReceived(catalog);
+        });
+        fw->setFuture(QtConcurrent::run(&m_writePool, [serverData, path] {
+            ServerCatalog catalog = decodeCatalog(serverData);
+            if (catalog.valid && !catalog.delta && catalog.code != 204 && !catalog.apps.isEmpty()) {
+                catalog.stored = storeCatalog(path, serverData);
             }
-            app_json.resize(0);
-            app_json.write(serverData);
-            app_json.close();
-        }
-
+            return catalog;
+        }));
     })
     .onError([this](QString errorStr) {
         emit loadError("request fail");
         return;
     })
-    .timeout(10 * 1000)
+    // no ceiling of its own, the full catalog takes a while on a slow link and only a stall aborts it
     .exec();
 }
 
-void PackageServerResourceManager::parseJson(QByteArray jsonData)
+ServerCatalog PackageServerResourceManager::decodeCatalog(const QByteArray &jsonData)
 {
-    auto json = QJsonDocument::fromJson(jsonData).object();
+    ServerCatalog catalog;
+    const QJsonObject json = QJsonDocument::fromJson(jsonData).object();
     if (json.empty()) {
+        return catalog;
+    }
+    catalog.valid = true;
+    catalog.code = json.value(QString::fromUtf8("code")).toInt();
+    catalog.delta = json.value(QString::fromUtf8("delta")).toBool();
+    catalog.version = json.value(QString::fromUtf8("version")).toString();
+
+    const QJsonArray appList = json.value(QString::fromUtf8("apps")).toArray();
+    catalog.apps.reserve(appList.size());
+    for (const QJsonValue &app : appList) {
+        catalog.apps += serverDataFromJson(app.toObject());
+    }
+    if (catalog.delta) {
+        catalog.changedApps = appList;
+        const QJsonArray removedList = json.value(QString::fromUtf8("removed")).toArray();
+        for (const QJsonValue &app : removedList) {
+            catalog.removed += app.toString();
+        }
+    } else {
+        catalog.checksum = QCryptographicHash::hash(jsonData, QCryptographicHash::Sha1);
+    }
+    return catalog;
+}
+
+ServerAppPage PackageServerResourceManager::decodeAppList(const QByteArray &jsonData)
+{
+    const QJsonObject json = QJsonDocument::fromJson(jsonData).object();
+    if (json.value(QString::fromUtf8("code")).toInt() != 200) {
+        return {};
+    }
+    const QJsonArray appList = json.value(QString::fromUtf8("apps")).toArray();
+    ServerAppPage page;
+    page.apps.reserve(appList.size());
+    for (const QJsonValue &app : appList) {
+        page.apps += serverDataFromJson(app.toObject());
+    }
+    // servers that do not page send everything without a cursor
+    page.nextCursor = json.value(QString::fromUtf8("nextCursor")).toString();
+    return page;
+}
+
+void PackageServerResourceManager::catalogReceived(const ServerCatalog &catalog)
+{
+    if (!catalog.valid) {
         emit loadError("data is null");
         return;
     }
-    auto httpCode = json.value(QString::fromUtf8("code")).toInt();
-    if (httpCode == 204) {
+    if (catalog.code == 204) {
+        emit packagesChanged({}, {}, {});
+        return;
+    }
+    if (catalog.delta) {
+        applyDelta(catalog);
+        return;
+    }
+    if (catalog.apps.isEmpty()) {
+        emit loadError("data size is empty");
+        return;
+    }
+    setCatalog(catalog);
+    if (catalog.stored) {
+        writeSnapshot();
+    }
+}
+
+void PackageServerResourceManager::setCatalog(const ServerCatalog &catalog)
+{
+    if (!catalog.valid) {
+        emit loadError("data is null");
+        return;
+    }
+    if (catalog.code == 204) {
         emit loadFinished();
         return;
     }
-    auto appList = json.value(QString::fromUtf8("apps")).toArray();
-    if (appList.size() < 1) {
+    if (catalog.apps.isEmpty()) {
         emit loadError("data size is empty");
         return;
     }
+    versionId = catalog.version;
     m_serverPackageNames.clear();
-    for (int i = 0; i < appList.size(); i++) {
-        auto appObj = appList.at(i).toObject();
-        auto appId = appObj.value(QString::fromUtf8("appId")).toString();
-        auto appName = appObj.value(QString::fromUtf8("appName")).toString();
-        auto icon = appObj.value(QString::fromUtf8("icon")).toString();
-        auto banner = appObj.value(QString::fromUtf8("banner")).toString();
-        auto categories = appObj.value(QString::fromUtf8("categories")).toArray();
-        auto display = appObj.value(QString::fromUtf8("display")).toArray();
-        QString name = "";
-        QString comment = "";
-        for (int j = 0; j < display.size(); j++) {
-            auto displayObj = display.at(j).toObject();
-            QString lang = "";
-            if (QLocale::system().bcp47Name().startsWith("zh")) {
-                lang = "cn";
-            } else {
-                lang = "en";
-            }
-            if (lang == displayObj.value(QString::fromUtf8("lang")).toString()) {
-                name = displayObj.value(QString::fromUtf8("name")).toString();
-                comment = displayObj.value(QString::fromUtf8("summary")).toString();
-            }
+    m_serverPackageNames.reserve(catalog.apps.size());
+    for (const ServerData &currentData : catalog.apps) {
+        m_serverPackageNames.append(currentData.appName);
+        serverPackages.insert(currentData.appName, currentData);
+    }
+    // everything lives in serverPackages now, the mapping is not needed anymore
+    m_snapshot.close();
+    m_catalogChecksum = catalog.checksum;
+    updateSearchIndex(m_catalogChecksum);
+    // what only the previous catalog used
+    StringPool::global()->squeeze();
+
+    if (!isCacheData) {
+        emit loadFinished();
+    }
+}
+
+void PackageServerResourceManager::applyDelta(const ServerCatalog &catalog)
+{
+    // the snapshot is read-only, the delta is applied to an in-memory copy
+    if (serverPackages.isEmpty() && m_snapshot.isOpen()) {
+        const int count = m_snapshot.count();
+        serverPackages.reserve(count);
+        for (int i = 0; i < count; ++i) {
+            const ServerData data = m_snapshot.record(i);
+            serverPackages.insert(data.appName, data);
         }
-        QString categoryDisplay = "";
-        QSet<QString> categoriesSets;
-        for (int j = 0; j < categories.size(); j++) {
-            QString currentType = categories.at(j).toString();
-            categoryDisplay += currentType;
-            categoriesSets.insert(currentType);
-            if (j != categories.size() - 1) {
-                categoryDisplay += ",";
-            }
+    }
+    m_snapshot.close();
+
+    QStringList added;
+    QStringList changed;
+    QSet<QString> removed;
+    for (const ServerData &data : catalog.apps) {
+        auto it = serverPackages.find(data.appName);
+        if (it == serverPackages.end()) {
+            m_serverPackageNames.append(data.appName);
+            serverPackages.insert(data.appName, data);
+            added += data.appName;
+        } else if (*it != data) {
+            *it = data;
+            changed += data.appName;
+        }
+    }
+    for (const QString &appName : catalog.removed) {
+        if (serverPackages.remove(appName) > 0) {
+            removed.insert(appName);
         }
-        m_serverPackageNames.append(appName);
-        ServerData currentData;
-        currentData.appId = appId;
-        currentData.banner = banner;
-        currentData.categoryDisplay = categoryDisplay;
-        currentData.comment = comment;
-        currentData.icon = icon;
-        currentData.name = name;
-        currentData.appName = appName;
-        currentData.categoriesSet = categoriesSets;
-        serverPackages.insert(appName,currentData);
+    }
+    if (!removed.isEmpty()) {
+        m_serverPackageNames.erase(std::remove_if(m_serverPackageNames.begin(), m_serverPackageNames.end(), [&removed](const QString &appName) {
+            return removed.contains(appName);
+        }), m_serverPackageNames.end());
+    }
 
+    const QString version = catalog.version;
+    const QJsonArray appList = catalog.changedApps;
+    if (added.isEmpty() && changed.isEmpty() && removed.isEmpty() && version == versionId) {
+        emit packagesChanged({}, {}, {});
+        return;
+    }
+    versionId = version;
+    if (!added.isEmpty() || !changed.isEmpty() || !removed.isEmpty()) {
+        rebuildSearchIndex();
+        StringPool::global()->squeeze();
     }
 
-    if (!isCacheData) {
-        emit loadFinished();
+    // the JSON, the snapshot and the index on disk are rewritten together so they keep matching
+    const QString cacheDir = QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+    const QVector<ServerData> records = catalogRecords();
+    const PackageServerSearchIndex index = m_searchIndex;
+    QtConcurrent::run(&m_writePool, [cacheDir, appList, removed, version, records, index] {
+        const QByteArray jsonData = mergeCatalog(cacheDir + QLatin1String(CACHE_FILENAME), appList, removed, version);
+        if (jsonData.isEmpty()) {
+            return;
+        }
+        const QByteArray checksum = QCryptographicHash::hash(jsonData, QCryptographicHash::Sha1);
+        writeSnapshotFile(cacheDir, records, checksum, version);
+        index.save(cacheDir + QLatin1String(INDEX_FILENAME), checksum);
+    });
+
+    emit packagesChanged(added, changed, removed.values());
+}
+
+QVector<ServerData> PackageServerResourceManager::catalogRecords() const
+{
+    QVector<ServerData> records;
+    records.reserve(m_serverPackageNames.size());
+    for (const QString &appName : qAsConst(m_serverPackageNames)) {
+        records += serverPackages.value(appName);
+    }
+    return records;
+}
+
+bool PackageServerResourceManager::openSnapshot()
+{
+    const QString cacheDir = QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+    if (!m_snapshot.open(cacheDir + QLatin1String(SNAPSHOT_FILENAME), QFileInfo(cacheDir + QLatin1String(CACHE_FILENAME)))) {
+        return false;
+    }
+    m_serverPackageNames = m_snapshot.appNames();
+    m_catalogChecksum = m_snapshot.sourceChecksum();
+    versionId = m_snapshot.catalogVersion();
+    updateSearchIndex(m_catalogChecksum);
+    return true;
+}
+
+void PackageServerResourceManager::writeSnapshot()
+{
+    if (serverPackages.isEmpty()) {
+        return;
+    }
+    const QString cacheDir = QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+    const QVector<ServerData> records = catalogRecords();
+    const QByteArray checksum = m_catalogChecksum;
+    const QString version = versionId;
+    QtConcurrent::run(&m_writePool, [cacheDir, records, checksum, version] {
+        writeSnapshotFile(cacheDir, records, checksum, version);
+    });
+}
+
+void PackageServerResourceManager::updateSearchIndex(const QByteArray &checksum)
+{
+    // The index is keyed by the catalog contents, so an unchanged catalog reuses the one on disk
+    const QString path = QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + QLatin1String(INDEX_FILENAME);
+    if (m_searchIndex.load(path, checksum)) {
+        return;
+    }
+
+    rebuildSearchIndex();
+    const PackageServerSearchIndex index = m_searchIndex;
+    QtConcurrent::run(&m_writePool, [index, path, checksum] {
+        if (!index.save(path, checksum)) {
+            qWarning() << "could not write the search index to" << path;
+        }
+    });
+}
+
+void PackageServerResourceManager::rebuildSearchIndex()
+{
+    m_searchIndex.clear();
+    for (const QString &appName : qAsConst(m_serverPackageNames)) {
+        const ServerData data = resourceByName(appName);
+        m_searchIndex.addEntry(appName, {data.name, data.comment, data.appName, data.categoryDisplay});
     }
+    m_searchIndex.finalize();
 }
 
 void PackageServerResourceManager::refreshData()
@@ -203,36 +495,48 @@ bool PackageServerResourceManager::existPackageName(QString pkgName)
 {
 //   qDebug()<<Q_FUNC_INFO<<" pkgName:::" << pkgName;
 
-    bool isExist = serverPackages.contains(pkgName);
+    bool isExist = serverPackages.contains(pkgName) || m_snapshot.indexOf(pkgName) >= 0;
 
     return isExist;
 }
 ServerData PackageServerResourceManager::resourceByName(QString pkgName)
 {
-    return serverPackages.value(pkgName);
+    const auto it = serverPackages.constFind(pkgName);
+    if (it != serverPackages.constEnd()) {
+        return *it;
+    }
+    const int index = m_snapshot.indexOf(pkgName);
+    return index < 0 ? ServerData() : m_snapshot.record(index);
 }
 
 QList<ServerData> PackageServerResourceManager::resourceByCategory(QString categoryName)
 {
-    auto resources = kFilter<QList<ServerData>>(serverPackages, [categoryName](ServerData res) {
+    if (serverPackages.isEmpty() && m_snapshot.isOpen()) {
+        const QVector<int> indexes = m_snapshot.recordsInCategory(categoryName);
+        QList<ServerData> resources;
+        resources.reserve(indexes.size());
+        for (int index : indexes) {
+            resources += m_snapshot.record(index);
+        }
+        return resources;
+    }
+
+    auto resources = kFilter<QList<ServerData>>(serverPackages, [&categoryName](const ServerData &res) {
         return res.categoriesSet.contains(categoryName);
     });
     return resources;
 }
+
 QList<ServerData> PackageServerResourceManager::resourceByKeyword(QString keyword)
 {
+    const QStringList appNames = m_searchIndex.search(keyword);
     QList<ServerData> allResult;
-//    QSet<ServerData> localCacheServerData = QSet<ServerData>(serverPackages.values().begin(), serverPackages.values().end());
-//    auto startWithResource = kFilter<QList<ServerData>>(serverPackages, [keyword](ServerData res) {
-//                                              bool isExist = res.name.startsWith(keyword);
-//        return isExist;
-//    });
-//    allResult += startWithResource;
-//    allResult.unite(QSet<ServerData>(startWithResource.begin(), startWithResource.end()));
-    auto resources = kFilter<QList<ServerData>>(serverPackages, [keyword](ServerData res) {
-        bool isExist = res.name.contains(keyword);
-        return isExist;
-    });
-    allResult += resources;
+    allResult.reserve(appNames.size());
+    for (const QString &appName : appNames) {
+        const ServerData data = resourceByName(appName);
+        if (!data.appName.isEmpty()) {
+            allResult += data;
+        }
+    }
     return allResult;
 }
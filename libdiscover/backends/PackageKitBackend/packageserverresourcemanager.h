@@ -7,7 +7,12 @@
 #include <QMap>
 #include <QThreadPool>
 #include <QSet>
+#include <QJsonObject>
+#include <QJsonArray>
+#include <QVector>
 #include "utils.h"
+#include "packageserversearchindex.h"
+#include "packageserversnapshot.h"
 
 struct ServerData {
     QString appId;
@@ -18,7 +23,39 @@ struct ServerData {
     QString categoryDisplay;
     QString comment;
     QSet<QString> categoriesSet;
+
+    bool operator==(const ServerData &other) const {
+        return appId == other.appId && appName == other.appName && banner == other.banner && icon == other.icon
+               && name == other.name && categoryDisplay == other.categoryDisplay && comment == other.comment
+               && categoriesSet == other.categoriesSet;
+    }
+    bool operator!=(const ServerData &other) const {
+        return !(*this == other);
+    }
+};
+
+/// The server catalog as parsed by PackageServerResourceManager::decodeCatalog
+struct ServerCatalog {
+    bool valid = false;
+    int code = 0;
+    bool delta = false;
+    QString version;
+    QVector<ServerData> apps;
+    /// for deltas, the apps as sent to be merged into the cached catalog
+    QJsonArray changedApps;
+    QStringList removed;
+    QByteArray checksum;
+    /// the full catalog differed from the cached one and replaced it
+    bool stored = false;
+};
+
+/// One page of an applist response as parsed by PackageServerResourceManager::decodeAppList
+struct ServerAppPage {
+    QVector<ServerData> apps;
+    /// where the next page starts, empty on the last one
+    QString nextCursor;
 };
+
 class PackageServerResourceManager : public QObject
 {
     Q_OBJECT
@@ -31,12 +68,25 @@ public:
     bool existPackageName(QString pkgName);
     bool isRunning();
     void refreshData();
-    void parseJson(QByteArray jsonData);
+    void setCatalog(const ServerCatalog &catalog);
     ServerData resourceByName(QString pkgName);
     QList<ServerData> resourceByCategory(QString categoryName);
     QList<ServerData> resourceByKeyword(QString keyword);
 
+    /// These parse JSON and can be called from any thread
+    static ServerCatalog decodeCatalog(const QByteArray &jsonData);
+    /// @returns the apps of an applist response, none unless it succeeded
+    static ServerAppPage decodeAppList(const QByteArray &jsonData);
+
 private:
+    void catalogReceived(const ServerCatalog &catalog);
+    void applyDelta(const ServerCatalog &catalog);
+    QVector<ServerData> catalogRecords() const;
+    bool openSnapshot();
+    void writeSnapshot();
+    void updateSearchIndex(const QByteArray &checksum);
+    void rebuildSearchIndex();
+
     QTimer m_requestDataTimer;
     QHash<QString, ServerData> serverPackages;
     QString versionId;
@@ -44,13 +94,20 @@ private:
     QString etag;
     QString lastModified;
     QThreadPool m_threadPool;
+    /* writes the files in the cache directory, a single thread so they never overlap */
+    QThreadPool m_writePool;
     bool isCacheData = false;
+    PackageServerSearchIndex m_searchIndex;
+    PackageServerSnapshot m_snapshot;
+    QByteArray m_catalogChecksum;
 
 
 Q_SIGNALS:
     void loadStart();
     void serverPackage(QString appName,ServerData serverD);
     void loadFinished();
+    /// emitted instead of loadFinished when the server only sent what changed
+    void packagesChanged(const QStringList &added, const QStringList &changed, const QStringList &removed);
     void loadError(QString error);
 };
 
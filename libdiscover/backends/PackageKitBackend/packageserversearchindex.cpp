@@ -0,0 +1,189 @@
+/*
+ *   SPDX-FileCopyrightText:      2021 Wang Rui <wangrui@jingos.com>
+ *   SPDX-License-Identifier:     LGPL-2.1-only OR LGPL-3.0-only OR LicenseRef-KDE-Accepted-LGPL
+ */
+#include "packageserversearchindex.h"
+#include <QDataStream>
+#include <QFile>
+#include <QSaveFile>
+#include <algorithm>
+
+static const quint32 s_indexMagic = 0x44534958; // "DSIX"
+static const quint32 s_indexVersion = 1;
+
+static bool isCjk(QChar c)
+{
+    const ushort u = c.unicode();
+    return (u >= 0x4E00 && u <= 0x9FFF)     // CJK unified ideographs
+           || (u >= 0x3400 && u <= 0x4DBF)  // CJK extension A
+           || (u >= 0xF900 && u <= 0xFAFF)  // CJK compatibility ideographs
+           || (u >= 0x3040 && u <= 0x30FF)  // hiragana and katakana
+           || (u >= 0xAC00 && u <= 0xD7AF); // hangul syllables
+}
+
+static void appendCjkRun(const QString &run, PackageServerSearchIndex::TokenizeMode mode, QStringList &tokens)
+{
+    if (run.isEmpty())
+        return;
+
+    // Queries only need the bigrams, every bigram implies its unigrams
+    if (mode == PackageServerSearchIndex::IndexMode || run.size() == 1) {
+        for (const QChar &c : run)
+            tokens += QString(c);
+    }
+    for (int i = 0; i + 1 < run.size(); ++i)
+        tokens += run.mid(i, 2);
+}
+
+QStringList PackageServerSearchIndex::tokenize(const QString &text, TokenizeMode mode)
+{
+    QStringList tokens;
+    const QString folded = text.toCaseFolded();
+    QString word;
+    QString cjkRun;
+    for (const QChar &c : folded) {
+        if (isCjk(c)) {
+            if (!word.isEmpty()) {
+                tokens += word;
+                word.clear();
+            }
+            cjkRun += c;
+        } else {
+            appendCjkRun(cjkRun, mode, tokens);
+            cjkRun.clear();
+            if (c.isLetterOrNumber()) {
+                word += c;
+            } else if (!word.isEmpty()) {
+                tokens += word;
+                word.clear();
+            }
+        }
+    }
+    appendCjkRun(cjkRun, mode, tokens);
+    if (!word.isEmpty())
+        tokens += word;
+    return tokens;
+}
+
+void PackageServerSearchIndex::clear()
+{
+    m_documents.clear();
+    m_terms.clear();
+    m_postings.clear();
+    m_pending.clear();
+}
+
+void PackageServerSearchIndex::addEntry(const QString &appName, const QStringList &fields)
+{
+    const int docId = m_documents.size();
+    m_documents += appName;
+    for (const QString &field : fields) {
+        const auto tokens = tokenize(field, IndexMode);
+        for (const QString &token : tokens) {
+            auto &postings = m_pending[token];
+            // documents are added in order, so a posting list only needs to check its tail
+            if (postings.isEmpty() || postings.constLast() != docId)
+                postings += docId;
+        }
+    }
+}
+
+void PackageServerSearchIndex::finalize()
+{
+    m_terms = m_pending.keys().toVector();
+    std::sort(m_terms.begin(), m_terms.end());
+    m_postings.clear();
+    m_postings.reserve(m_terms.size());
+    for (const QString &term : qAsConst(m_terms))
+        m_postings += m_pending.value(term);
+    m_pending.clear();
+}
+
+QVector<int> PackageServerSearchIndex::postingsForPrefix(const QString &prefix) const
+{
+    auto it = std::lower_bound(m_terms.constBegin(), m_terms.constEnd(), prefix);
+    const auto first = it;
+    QVector<int> ret;
+    for (; it != m_terms.constEnd() && it->startsWith(prefix); ++it) {
+        ret += m_postings.at(it - m_terms.constBegin());
+    }
+
+    // an exact match only has one posting list, which is already sorted and unique
+    if (it - first > 1) {
+        std::sort(ret.begin(), ret.end());
+        ret.erase(std::unique(ret.begin(), ret.end()), ret.end());
+    }
+    return ret;
+}
+
+QStringList PackageServerSearchIndex::search(const QString &query) const
+{
+    const QStringList tokens = tokenize(query, QueryMode);
+    if (tokens.isEmpty())
+        return {};
+
+    QVector<int> matches;
+    bool first = true;
+    for (const QString &token : tokens) {
+        const QVector<int> postings = postingsForPrefix(token);
+        if (first) {
+            matches = postings;
+            first = false;
+        } else {
+            QVector<int> intersection;
+            std::set_intersection(matches.constBegin(), matches.constEnd(), postings.constBegin(), postings.constEnd(), std::back_inserter(intersection));
+            matches = intersection;
+        }
+        if (matches.isEmpty())
+            return {};
+    }
+
+    QStringList ret;
+    ret.reserve(matches.size());
+    for (int docId : qAsConst(matches))
+        ret += m_documents.at(docId);
+    return ret;
+}
+
+bool PackageServerSearchIndex::save(const QString &path, const QByteArray &sourceChecksum) const
+{
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly))
+        return false;
+
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_5_15);
+    stream << s_indexMagic << s_indexVersion << sourceChecksum << m_documents << m_terms << m_postings;
+    return stream.status() == QDataStream::Ok && file.commit();
+}
+
+bool PackageServerSearchIndex::load(const QString &path, const QByteArray &sourceChecksum)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly))
+        return false;
+
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_5_15);
+    quint32 magic = 0, version = 0;
+    QByteArray checksum;
+    stream >> magic >> version;
+    if (magic != s_indexMagic || version != s_indexVersion)
+        return false;
+    stream >> checksum;
+    if (checksum != sourceChecksum)
+        return false;
+
+    QVector<QString> documents;
+    QVector<QString> terms;
+    QVector<QVector<int>> postings;
+    stream >> documents >> terms >> postings;
+    if (stream.status() != QDataStream::Ok || terms.size() != postings.size())
+        return false;
+
+    m_documents = documents;
+    m_terms = terms;
+    m_postings = postings;
+    m_pending.clear();
+    return true;
+}
@@ -0,0 +1,58 @@
+/*
+ *   SPDX-FileCopyrightText:      2021 Wang Rui <wangrui@jingos.com>
+ *   SPDX-License-Identifier:     LGPL-2.1-only OR LGPL-3.0-only OR LicenseRef-KDE-Accepted-LGPL
+ */
+#ifndef PACKAGESERVERSEARCHINDEX_H
+#define PACKAGESERVERSEARCHINDEX_H
+
+#include <QByteArray>
+#include <QHash>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+/**
+ * Inverted index over the server app catalog.
+ *
+ * Text is case folded and split into words; runs of CJK characters are
+ * indexed as unigrams plus bigrams since they carry no word separators.
+ * Every query token is matched as a prefix of the indexed terms and the
+ * results of all query tokens are intersected.
+ */
+class PackageServerSearchIndex
+{
+public:
+    enum TokenizeMode {
+        IndexMode,
+        QueryMode
+    };
+
+    void clear();
+    int size() const {
+        return m_documents.size();
+    }
+
+    /// Adds a document, only valid before finalize() is called
+    void addEntry(const QString &appName, const QStringList &fields);
+    /// Sorts the term dictionary so it can be used for prefix lookups
+    void finalize();
+
+    /// @returns the app names matching @p query, in insertion order
+    QStringList search(const QString &query) const;
+
+    bool save(const QString &path, const QByteArray &sourceChecksum) const;
+    /// @returns false if the file is missing, corrupt or built from other data
+    bool load(const QString &path, const QByteArray &sourceChecksum);
+
+    static QStringList tokenize(const QString &text, TokenizeMode mode = IndexMode);
+
+private:
+    QVector<int> postingsForPrefix(const QString &prefix) const;
+
+    QVector<QString> m_documents;
+    QVector<QString> m_terms;
+    QVector<QVector<int>> m_postings;
+    QHash<QString, QVector<int>> m_pending;
+};
+
+#endif // PACKAGESERVERSEARCHINDEX_H
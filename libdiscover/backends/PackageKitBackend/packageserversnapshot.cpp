@@ -0,0 +1,313 @@
+/*
+ *   SPDX-FileCopyrightText:      2021 Wang Rui <wangrui@jingos.com>
+ *   SPDX-License-Identifier:     LGPL-2.1-only OR LGPL-3.0-only OR LicenseRef-KDE-Accepted-LGPL
+ */
+#include "packageserversnapshot.h"
+#include "packageserverresourcemanager.h"
+#include "resources/StringPool.h"
+#include <QDateTime>
+#include <QHash>
+#include <QSaveFile>
+#include <algorithm>
+#include <cstring>
+
+static const quint32 s_snapshotMagic = 0x44534e50; // "DSNP"
+static const quint32 s_snapshotVersion = 2;
+
+struct PackageServerSnapshot::StringRef {
+    quint32 offset;
+    quint32 length;
+};
+
+struct PackageServerSnapshot::Record {
+    StringRef appId;
+    StringRef appName;
+    StringRef banner;
+    StringRef icon;
+    StringRef name;
+    StringRef categoryDisplay;
+    StringRef comment;
+};
+
+struct PackageServerSnapshot::Header {
+    quint32 magic;
+    quint32 version;
+    quint32 recordCount;
+    quint32 categoryCount;
+    quint32 bitmapWords; // per record
+    quint32 stringsSize; // in UTF-16 code units
+    quint32 categoriesOffset;
+    quint32 recordsOffset;
+    quint32 bitmapOffset;
+    quint32 stringsOffset;
+    qint64 sourceSize;
+    qint64 sourceModified;
+    char sourceChecksum[20];
+    StringRef catalogVersion;
+    quint32 reserved;
+};
+
+PackageServerSnapshot::PackageServerSnapshot() = default;
+
+PackageServerSnapshot::~PackageServerSnapshot()
+{
+    close();
+}
+
+bool PackageServerSnapshot::open(const QString &path, const QFileInfo &source)
+{
+    close();
+    if (!source.exists())
+        return false;
+
+    m_file.setFileName(path);
+    if (!m_file.open(QIODevice::ReadOnly))
+        return false;
+
+    m_size = m_file.size();
+    if (m_size < qint64(sizeof(Header))) {
+        close();
+        return false;
+    }
+    m_data = m_file.map(0, m_size);
+    if (!m_data) {
+        close();
+        return false;
+    }
+
+    const Header *h = header();
+    const quint64 size = quint64(m_size);
+    const bool valid = h->magic == s_snapshotMagic && h->version == s_snapshotVersion
+                       && h->sourceSize == source.size()
+                       && h->sourceModified == source.lastModified().toMSecsSinceEpoch()
+                       && quint64(h->categoriesOffset) + quint64(h->categoryCount) * sizeof(StringRef) <= size
+                       && quint64(h->recordsOffset) + quint64(h->recordCount) * sizeof(Record) <= size
+                       && quint64(h->bitmapOffset) + quint64(h->recordCount) * h->bitmapWords * sizeof(quint32) <= size
+                       && quint64(h->stringsOffset) + quint64(h->stringsSize) * sizeof(QChar) <= size
+                       && quint64(h->bitmapWords) * 32 >= h->categoryCount;
+    if (!valid) {
+        close();
+        return false;
+    }
+    return true;
+}
+
+void PackageServerSnapshot::close()
+{
+    if (m_data) {
+        m_file.unmap(const_cast<uchar *>(m_data));
+        m_data = nullptr;
+    }
+    m_size = 0;
+    if (m_file.isOpen())
+        m_file.close();
+}
+
+const PackageServerSnapshot::Header *PackageServerSnapshot::header() const
+{
+    return reinterpret_cast<const Header *>(m_data);
+}
+
+const PackageServerSnapshot::Record *PackageServerSnapshot::records() const
+{
+    return reinterpret_cast<const Record *>(m_data + header()->recordsOffset);
+}
+
+QStringView PackageServerSnapshot::stringAt(const StringRef &ref) const
+{
+    const Header *h = header();
+    if (quint64(ref.offset) + ref.length > h->stringsSize)
+        return {};
+    const QChar *strings = reinterpret_cast<const QChar *>(m_data + h->stringsOffset);
+    return QStringView(strings + ref.offset, ref.length);
+}
+
+int PackageServerSnapshot::count() const
+{
+    return isOpen() ? int(header()->recordCount) : 0;
+}
+
+QByteArray PackageServerSnapshot::sourceChecksum() const
+{
+    if (!isOpen())
+        return {};
+    return QByteArray(header()->sourceChecksum, sizeof(Header::sourceChecksum));
+}
+
+QString PackageServerSnapshot::catalogVersion() const
+{
+    if (!isOpen())
+        return {};
+    return stringAt(header()->catalogVersion).toString();
+}
+
+int PackageServerSnapshot::indexOf(const QString &appName) const
+{
+    if (!isOpen())
+        return -1;
+
+    const Record *begin = records();
+    const Record *end = begin + count();
+    const Record *it = std::lower_bound(begin, end, appName, [this](const Record &record, const QString &name) {
+        return stringAt(record.appName).compare(name) < 0;
+    });
+    if (it == end || stringAt(it->appName).compare(appName) != 0)
+        return -1;
+    return int(it - begin);
+}
+
+QString PackageServerSnapshot::appName(int index) const
+{
+    Q_ASSERT(index >= 0 && index < count());
+    return StringPool::global()->intern(stringAt(records()[index].appName));
+}
+
+ServerData PackageServerSnapshot::record(int index) const
+{
+    Q_ASSERT(index >= 0 && index < count());
+    const Header *h = header();
+    const Record &record = records()[index];
+
+    // looked up for every resource shown, the same strings are handed out each time
+    StringPool *pool = StringPool::global();
+    ServerData ret;
+    ret.appId = pool->intern(stringAt(record.appId));
+    ret.appName = pool->intern(stringAt(record.appName));
+    ret.banner = pool->intern(stringAt(record.banner));
+    ret.icon = pool->intern(stringAt(record.icon));
+    ret.name = pool->intern(stringAt(record.name));
+    ret.categoryDisplay = pool->intern(stringAt(record.categoryDisplay));
+    ret.comment = pool->intern(stringAt(record.comment));
+
+    const StringRef *categories = reinterpret_cast<const StringRef *>(m_data + h->categoriesOffset);
+    const quint32 *bitmap = reinterpret_cast<const quint32 *>(m_data + h->bitmapOffset) + quint64(index) * h->bitmapWords;
+    for (quint32 c = 0; c < h->categoryCount; ++c) {
+        if (bitmap[c / 32] & (1u << (c % 32)))
+            ret.categoriesSet.insert(pool->intern(stringAt(categories[c])));
+    }
+    return ret;
+}
+
+QStringList PackageServerSnapshot::appNames() const
+{
+    QStringList ret;
+    const int total = count();
+    ret.reserve(total);
+    for (int i = 0; i < total; ++i)
+        ret += appName(i);
+    return ret;
+}
+
+QVector<int> PackageServerSnapshot::recordsInCategory(const QString &category) const
+{
+    if (!isOpen())
+        return {};
+
+    const Header *h = header();
+    const StringRef *categories = reinterpret_cast<const StringRef *>(m_data + h->categoriesOffset);
+    quint32 categoryId = 0;
+    for (; categoryId < h->categoryCount; ++categoryId) {
+        if (stringAt(categories[categoryId]).compare(category) == 0)
+            break;
+    }
+    if (categoryId == h->categoryCount)
+        return {};
+
+    QVector<int> ret;
+    const quint32 *bitmap = reinterpret_cast<const quint32 *>(m_data + h->bitmapOffset);
+    const quint32 word = categoryId / 32;
+    const quint32 mask = 1u << (categoryId % 32);
+    for (quint32 i = 0; i < h->recordCount; ++i) {
+        if (bitmap[quint64(i) * h->bitmapWords + word] & mask)
+            ret += int(i);
+    }
+    return ret;
+}
+
+bool PackageServerSnapshot::write(const QString &path, const QVector<ServerData> &data, const QFileInfo &source, const QByteArray &sourceChecksum, const QString &catalogVersion)
+{
+    static_assert(sizeof(Header) % 8 == 0, "the snapshot sections need to stay aligned");
+    if (!source.exists())
+        return false;
+
+    QVector<const ServerData *> sorted;
+    sorted.reserve(data.size());
+    for (const ServerData &d : data)
+        sorted += &d;
+    std::sort(sorted.begin(), sorted.end(), [](const ServerData *a, const ServerData *b) {
+        return a->appName < b->appName;
+    });
+
+    QStringList categoryNames;
+    QHash<QString, quint32> categoryIds;
+    for (const ServerData *d : qAsConst(sorted)) {
+        for (const QString &category : d->categoriesSet) {
+            if (!categoryIds.contains(category)) {
+                categoryIds.insert(category, categoryNames.size());
+                categoryNames += category;
+            }
+        }
+    }
+    const quint32 bitmapWords = quint32((categoryNames.size() + 31) / 32);
+
+    // identical strings (categories, empty banners...) are stored once
+    QString strings;
+    QHash<QString, StringRef> interned;
+    const auto intern = [&strings, &interned](const QString &value) {
+        if (value.isEmpty())
+            return StringRef{0, 0};
+        const auto it = interned.constFind(value);
+        if (it != interned.constEnd())
+            return *it;
+        const StringRef ref{quint32(strings.size()), quint32(value.size())};
+        strings += value;
+        interned.insert(value, ref);
+        return ref;
+    };
+
+    const StringRef versionRef = intern(catalogVersion);
+    QVector<StringRef> categoryRefs;
+    categoryRefs.reserve(categoryNames.size());
+    for (const QString &category : qAsConst(categoryNames))
+        categoryRefs += intern(category);
+
+    QVector<Record> records;
+    records.reserve(sorted.size());
+    QVector<quint32> bitmap(sorted.size() * int(bitmapWords), 0);
+    for (int i = 0; i < sorted.size(); ++i) {
+        const ServerData *d = sorted.at(i);
+        records += Record{intern(d->appId), intern(d->appName), intern(d->banner), intern(d->icon),
+                          intern(d->name), intern(d->categoryDisplay), intern(d->comment)};
+        for (const QString &category : d->categoriesSet) {
+            const quint32 id = categoryIds.value(category);
+            bitmap[i * int(bitmapWords) + int(id / 32)] |= 1u << (id % 32);
+        }
+    }
+
+    Header h;
+    std::memset(&h, 0, sizeof(h));
+    h.magic = s_snapshotMagic;
+    h.version = s_snapshotVersion;
+    h.recordCount = quint32(records.size());
+    h.categoryCount = quint32(categoryRefs.size());
+    h.bitmapWords = bitmapWords;
+    h.stringsSize = quint32(strings.size());
+    h.categoriesOffset = sizeof(Header);
+    h.recordsOffset = h.categoriesOffset + quint32(categoryRefs.size() * sizeof(StringRef));
+    h.bitmapOffset = h.recordsOffset + quint32(records.size() * sizeof(Record));
+    h.stringsOffset = h.bitmapOffset + quint32(bitmap.size() * sizeof(quint32));
+    h.sourceSize = source.size();
+    h.sourceModified = source.lastModified().toMSecsSinceEpoch();
+    h.catalogVersion = versionRef;
+    std::memcpy(h.sourceChecksum, sourceChecksum.constData(), qMin<int>(sourceChecksum.size(), sizeof(h.sourceChecksum)));
+
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly))
+        return false;
+    file.write(reinterpret_cast<const char *>(&h), sizeof(h));
+    file.write(reinterpret_cast<const char *>(categoryRefs.constData()), categoryRefs.size() * sizeof(StringRef));
+    file.write(reinterpret_cast<const char *>(records.constData()), records.size() * sizeof(Record));
+    file.write(reinterpret_cast<const char *>(bitmap.constData()), bitmap.size() * sizeof(quint32));
+    file.write(reinterpret_cast<const char *>(strings.constData()), strings.size() * sizeof(QChar));
+    return file.commit();
+}
@@ -0,0 +1,69 @@
+/*
+ *   SPDX-FileCopyrightText:      2021 Wang Rui <wangrui@jingos.com>
+ *   SPDX-License-Identifier:     LGPL-2.1-only OR LGPL-3.0-only OR LicenseRef-KDE-Accepted-LGPL
+ */
+#ifndef PACKAGESERVERSNAPSHOT_H
+#define PACKAGESERVERSNAPSHOT_H
+
+#include <QFile>
+#include <QFileInfo>
+#include <QStringList>
+#include <QStringView>
+#include <QVector>
+
+struct ServerData;
+
+/**
+ * Memory mapped binary copy of allAppinfo.json.
+ *
+ * The file holds a header, the category names, one fixed-size record per
+ * app sorted by appName, a category bitmap per record and a UTF-16 string
+ * table. Nothing is decoded when the file is opened, strings are only
+ * materialised for the records that are actually requested.
+ *
+ * The snapshot records the size and modification time of the JSON it was
+ * made from and refuses to open once they no longer match.
+ */
+class PackageServerSnapshot
+{
+public:
+    PackageServerSnapshot();
+    ~PackageServerSnapshot();
+
+    bool open(const QString &path, const QFileInfo &source);
+    void close();
+    bool isOpen() const {
+        return m_data != nullptr;
+    }
+
+    int count() const;
+    /// SHA-1 of the JSON document the snapshot was created from
+    QByteArray sourceChecksum() const;
+    /// version the server reported for the catalog, sent back for delta updates
+    QString catalogVersion() const;
+
+    /// @returns the record index for @p appName or -1, using a binary search
+    int indexOf(const QString &appName) const;
+    QString appName(int index) const;
+    ServerData record(int index) const;
+    QStringList appNames() const;
+    QVector<int> recordsInCategory(const QString &category) const;
+
+    static bool write(const QString &path, const QVector<ServerData> &records, const QFileInfo &source,
+                      const QByteArray &sourceChecksum, const QString &catalogVersion);
+
+private:
+    struct Header;
+    struct StringRef;
+    struct Record;
+
+    const Header *header() const;
+    const Record *records() const;
+    QStringView stringAt(const StringRef &ref) const;
+
+    QFile m_file;
+    const uchar *m_data = nullptr;
+    qint64 m_size = 0;
+};
+
+#endif // PACKAGESERVERSNAPSHOT_H
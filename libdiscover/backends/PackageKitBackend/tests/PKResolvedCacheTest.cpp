@@ -0,0 +1,71 @@
+/*
+ *   SPDX-FileCopyrightText: 2021 Wang Rui <wangrui@jingos.com>
+ *   SPDX-License-Identifier: GPL-2.0-only OR GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+ */
+
+#include <QtTest>
+#include <QTemporaryDir>
+#include "PKResolvedCache.h"
+
+class PKResolvedCacheTest : public QObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+    void testRestart()
+    {
+        QTemporaryDir dir;
+        const QString path = dir.filePath(QStringLiteral("pkresolved.cache"));
+        const PKResolvedCache::Key key = { 1000, 2000, 0, 3000 };
+        const QVariantMap details = {
+            { QStringLiteral("package-id"), QStringLiteral("kalgebra;21.08;x86_64;main") },
+            { QStringLiteral("size"), quint64(4200) },
+        };
+        {
+            PKResolvedCache cache(path);
+            cache.insert(QStringLiteral("kalgebra"), { { PackageKit::Transaction::InfoInstalled, QStringLiteral("kalgebra;21.08;x86_64;main"), QStringLiteral("Graph calculator") } });
+            cache.insert(QStringLiteral("missing"), {});
+            cache.insertDetails(details);
+            QVERIFY(cache.validate(key).isEmpty());
+        }
+
+        PKResolvedCache cache(path);
+        QVector<PKResolvedCache::Package> packages;
+        QVERIFY(cache.lookup(QStringLiteral("kalgebra"), &packages));
+        QCOMPARE(packages.count(), 1);
+        QCOMPARE(packages[0].info, PackageKit::Transaction::InfoInstalled);
+        QCOMPARE(packages[0].summary, QStringLiteral("Graph calculator"));
+        QVERIFY(cache.lookup(QStringLiteral("missing"), &packages));
+        QVERIFY(packages.isEmpty());
+        QVERIFY(!cache.lookup(QStringLiteral("unknown"), &packages));
+        QCOMPARE(cache.details(QStringLiteral("kalgebra;21.08;x86_64;main")), details);
+
+        // "seconds since" measured a moment later
+        QVERIFY(cache.validate({ 1001, 2002, 0, 3000 }).isEmpty());
+        QVERIFY(cache.lookup(QStringLiteral("kalgebra"), &packages));
+    }
+
+    void testStale()
+    {
+        QTemporaryDir dir;
+        const QString path = dir.filePath(QStringLiteral("pkresolved.cache"));
+        {
+            PKResolvedCache cache(path);
+            cache.validate({ 1000 });
+            cache.insert(QStringLiteral("kalgebra"), { { PackageKit::Transaction::InfoAvailable, QStringLiteral("kalgebra;21.08;x86_64;main"), {} } });
+            cache.insert(QStringLiteral("kate"), { { PackageKit::Transaction::InfoAvailable, QStringLiteral("kate;21.08;x86_64;main"), {} } });
+        }
+
+        PKResolvedCache cache(path);
+        // looked up again before the key is known, that one is current
+        cache.insert(QStringLiteral("kate"), { { PackageKit::Transaction::InfoInstalled, QStringLiteral("kate;21.08;x86_64;main"), {} } });
+        QCOMPARE(cache.validate({ 5000 }), QStringList{ QStringLiteral("kalgebra") });
+        QVector<PKResolvedCache::Package> packages;
+        QVERIFY(!cache.lookup(QStringLiteral("kalgebra"), &packages));
+        QVERIFY(cache.lookup(QStringLiteral("kate"), &packages));
+        QCOMPARE(packages[0].info, PackageKit::Transaction::InfoInstalled);
+    }
+};
+
+QTEST_GUILESS_MAIN(PKResolvedCacheTest)
+
+#include "PKResolvedCacheTest.moc"
@@ -0,0 +1,122 @@
+/*
+ *   SPDX-FileCopyrightText:      2021 Wang Rui <wangrui@jingos.com>
+ *   SPDX-License-Identifier:     LGPL-2.1-only OR LGPL-3.0-only OR LicenseRef-KDE-Accepted-LGPL
+ */
+
+#include <QtTest>
+#include <QTemporaryDir>
+#include "packageserversearchindex.h"
+
+static void populate(PackageServerSearchIndex &index, int entries)
+{
+    static const QStringList words = {
+        QStringLiteral("office"), QStringLiteral("editor"), QStringLiteral("music"), QStringLiteral("player"),
+        QStringLiteral("browser"), QStringLiteral("terminal"), QStringLiteral("graphics"), QStringLiteral("game"),
+        QStringLiteral("viewer"), QStringLiteral("manager"), QStringLiteral("网络"), QStringLiteral("办公软件"),
+        QStringLiteral("音乐播放器"), QStringLiteral("图像编辑"), QStringLiteral("游戏")
+    };
+    for (int i = 0; i < entries; ++i) {
+        const QString appName = QStringLiteral("app-%1").arg(i);
+        const QString name = words.at(i % words.size()) + QLatin1Char(' ') + words.at((i / words.size()) % words.size()) + QString::number(i);
+        const QString comment = QStringLiteral("A %1 for %2").arg(words.at((i * 7) % words.size()), words.at((i * 3) % words.size()));
+        index.addEntry(appName, {name, comment, appName, QStringLiteral("Office,Utility")});
+    }
+    index.finalize();
+}
+
+class PackageServerSearchIndexTest : public QObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+    void testTokenize()
+    {
+        QCOMPARE(PackageServerSearchIndex::tokenize(QStringLiteral("LibreOffice Writer")),
+                 QStringList({QStringLiteral("libreoffice"), QStringLiteral("writer")}));
+        QCOMPARE(PackageServerSearchIndex::tokenize(QStringLiteral("微信")),
+                 QStringList({QStringLiteral("微"), QStringLiteral("信"), QStringLiteral("微信")}));
+        QCOMPARE(PackageServerSearchIndex::tokenize(QStringLiteral("音乐播放"), PackageServerSearchIndex::QueryMode),
+                 QStringList({QStringLiteral("音乐"), QStringLiteral("乐播"), QStringLiteral("播放")}));
+        QCOMPARE(PackageServerSearchIndex::tokenize(QStringLiteral("Qt5设计器")),
+                 QStringList({QStringLiteral("qt5"), QStringLiteral("设"), QStringLiteral("计"), QStringLiteral("器"),
+                              QStringLiteral("设计"), QStringLiteral("计器")}));
+    }
+
+    void testSearch()
+    {
+        PackageServerSearchIndex index;
+        index.addEntry(QStringLiteral("libreoffice-writer"), {QStringLiteral("LibreOffice Writer"), QStringLiteral("Word processor")});
+        index.addEntry(QStringLiteral("wechat"), {QStringLiteral("微信"), QStringLiteral("聊天工具")});
+        index.addEntry(QStringLiteral("netease-music"), {QStringLiteral("网易云音乐"), QStringLiteral("Music player")});
+        index.finalize();
+
+        QCOMPARE(index.search(QStringLiteral("libre")), QStringList({QStringLiteral("libreoffice-writer")}));
+        QCOMPARE(index.search(QStringLiteral("WRI")), QStringList({QStringLiteral("libreoffice-writer")}));
+        QCOMPARE(index.search(QStringLiteral("word proc")), QStringList({QStringLiteral("libreoffice-writer")}));
+        QCOMPARE(index.search(QStringLiteral("信")), QStringList({QStringLiteral("wechat")}));
+        QCOMPARE(index.search(QStringLiteral("云音乐")), QStringList({QStringLiteral("netease-music")}));
+        QCOMPARE(index.search(QStringLiteral("music")), QStringList({QStringLiteral("netease-music")}));
+        QVERIFY(index.search(QStringLiteral("音云")).isEmpty());
+        QVERIFY(index.search(QStringLiteral("writer music")).isEmpty());
+        QVERIFY(index.search(QStringLiteral("  ")).isEmpty());
+    }
+
+    void testSaveLoad()
+    {
+        QTemporaryDir dir;
+        QVERIFY(dir.isValid());
+        const QString path = dir.filePath(QStringLiteral("allAppinfo.index"));
+
+        PackageServerSearchIndex index;
+        populate(index, 100);
+        QVERIFY(index.save(path, "checksum"));
+
+        PackageServerSearchIndex loaded;
+        QVERIFY(!loaded.load(path, "other"));
+        QVERIFY(loaded.load(path, "checksum"));
+        QCOMPARE(loaded.size(), 100);
+        QCOMPARE(loaded.search(QStringLiteral("edit")), index.search(QStringLiteral("edit")));
+    }
+
+    void benchmarkBuild_data()
+    {
+        QTest::addColumn<int>("entries");
+        QTest::newRow("10k") << 10000;
+        QTest::newRow("100k") << 100000;
+    }
+
+    void benchmarkBuild()
+    {
+        QFETCH(int, entries);
+        QBENCHMARK {
+            PackageServerSearchIndex index;
+            populate(index, entries);
+        }
+    }
+
+    void benchmarkSearch_data()
+    {
+        benchmarkBuild_data();
+    }
+
+    void benchmarkSearch()
+    {
+        QFETCH(int, entries);
+        PackageServerSearchIndex index;
+        populate(index, entries);
+
+        // every keystroke of a query is a separate lookup
+        const QStringList keystrokes = {
+            QStringLiteral("m"), QStringLiteral("mu"), QStringLiteral("mus"), QStringLiteral("musi"),
+            QStringLiteral("music"), QStringLiteral("music p"), QStringLiteral("音"), QStringLiteral("音乐")
+        };
+        QBENCHMARK {
+            for (const QString &query : keystrokes) {
+                index.search(query);
+            }
+        }
+    }
+};
+
+QTEST_GUILESS_MAIN(PackageServerSearchIndexTest)
+
+#include "PackageServerSearchIndexTest.moc"
@@ -0,0 +1,199 @@
+/*
+ *   SPDX-FileCopyrightText:      2021 Wang Rui <wangrui@jingos.com>
+ *   SPDX-License-Identifier:     LGPL-2.1-only OR LGPL-3.0-only OR LicenseRef-KDE-Accepted-LGPL
+ */
+#include "HttpCache.h"
+
+#include <QBuffer>
+#include <QDateTime>
+#include <QDirIterator>
+#include <QStandardPaths>
+#include <algorithm>
+
+#define CACHE_DIRECTORY "/http"
+#define DISK_CACHE_SIZE (50 * 1024 * 1024)
+#define MEMORY_CACHE_SIZE (8 * 1024 * 1024)
+#define MEMORY_CACHE_ENTRIES 500
+// how stale the file time of an entry may get before a use refreshes it, in seconds
+#define TOUCH_INTERVAL (10 * 60)
+
+HttpCache::HttpCache(QObject *parent)
+    : HttpCache(QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + QLatin1String(CACHE_DIRECTORY), DISK_CACHE_SIZE, parent)
+{
+}
+
+HttpCache::HttpCache(const QString &directory, qint64 maximumSize, QObject *parent)
+    : QNetworkDiskCache(parent)
+    , m_metaData(MEMORY_CACHE_ENTRIES)
+    , m_data(MEMORY_CACHE_SIZE)
+{
+    setCacheDirectory(directory);
+    setMaximumCacheSize(maximumSize);
+}
+
+QNetworkCacheMetaData HttpCache::metaData(const QUrl &url)
+{
+    if (QNetworkCacheMetaData *metaData = m_metaData.object(url))
+        return *metaData;
+
+    const QNetworkCacheMetaData metaData = QNetworkDiskCache::metaData(url);
+    if (metaData.isValid())
+        m_metaData.insert(url, new QNetworkCacheMetaData(metaData));
+    return metaData;
+}
+
+void HttpCache::updateMetaData(const QNetworkCacheMetaData &metaData)
+{
+    // a 304 refreshes the headers of the entry, its data stays the same
+    m_metaData.remove(metaData.url());
+    QNetworkDiskCache::updateMetaData(metaData);
+}
+
+QIODevice *HttpCache::data(const QUrl &url)
+{
+    QByteArray content;
+    if (QByteArray *cached = m_data.object(url)) {
+        content = *cached;
+    } else {
+        QIODevice *device = QNetworkDiskCache::data(url);
+        if (!device)
+            return nullptr;
+        content = device->readAll();
+        delete device;
+        // entries bigger than the memory cache are just not kept
+        m_data.insert(url, new QByteArray(content), content.size());
+        touch(url);
+    }
+    ++m_hits;
+    m_bytesSaved += content.size();
+
+    QBuffer *buffer = new QBuffer;
+    buffer->setData(content);
+    buffer->open(QIODevice::ReadOnly);
+    return buffer;
+}
+
+bool HttpCache::remove(const QUrl &url)
+{
+    forget(url);
+    m_files.remove(url);
+    // a download that failed gets removed instead of inserted
+    for (auto it = m_preparing.begin(); it != m_preparing.end();) {
+        if (it.value() == url)
+            it = m_preparing.erase(it);
+        else
+            ++it;
+    }
+    return QNetworkDiskCache::remove(url);
+}
+
+QIODevice *HttpCache::prepare(const QNetworkCacheMetaData &metaData)
+{
+    QIODevice *device = QNetworkDiskCache::prepare(metaData);
+    if (device) {
+        // what is stored had to be downloaded
+        ++m_misses;
+        m_preparing.insert(device, metaData.url());
+    }
+    return device;
+}
+
+void HttpCache::insert(QIODevice *device)
+{
+    // until now data() kept handing out the previous response
+    const QUrl url = m_preparing.take(device);
+    forget(url);
+    QNetworkDiskCache::insert(device);
+}
+
+QVariantMap HttpCache::stats() const
+{
+    return {
+        { QStringLiteral("hits"), m_hits },
+        { QStringLiteral("misses"), m_misses },
+        { QStringLiteral("bytesSaved"), m_bytesSaved },
+    };
+}
+
+void HttpCache::clear()
+{
+    m_metaData.clear();
+    m_data.clear();
+    m_files.clear();
+    QNetworkDiskCache::clear();
+}
+
+qint64 HttpCache::expire()
+{
+    struct Entry {
+        QString path;
+        QUrl url;
+        qint64 size;
+        qint64 used;
+    };
+    // only the entries that are new since the last time have their header read
+    QHash<QString, QUrl> known;
+    known.reserve(m_files.size());
+    for (auto it = m_files.constBegin(); it != m_files.constEnd(); ++it)
+        known.insert(it.value(), it.key());
+    m_files.clear();
+    m_listed = true;
+
+    QVector<Entry> entries;
+    qint64 total = 0;
+    QDirIterator it(cacheDirectory(), {QStringLiteral("*.d")}, QDir::Files, QDirIterator::Subdirectories);
+    while (it.hasNext()) {
+        it.next();
+        const QFileInfo info = it.fileInfo();
+        QUrl url = known.value(info.filePath());
+        if (url.isEmpty())
+            url = fileMetaData(info.filePath()).url();
+        if (!url.isEmpty())
+            m_files.insert(url, info.filePath());
+        entries += Entry{info.filePath(), url, info.size(), info.lastModified().toMSecsSinceEpoch()};
+        total += info.size();
+    }
+    if (total < maximumCacheSize())
+        return total;
+
+    // QNetworkDiskCache drops the oldest downloads, the least recently used ones go first here, see touch()
+    std::sort(entries.begin(), entries.end(), [](const Entry &a, const Entry &b) {
+        return a.used < b.used;
+    });
+
+    // down to 90% so that the next insert does not expire again right away
+    const qint64 target = maximumCacheSize() * 9 / 10;
+    for (const Entry &entry : qAsConst(entries)) {
+        if (total <= target)
+            break;
+        if (QFile::remove(entry.path)) {
+            forget(entry.url);
+            m_files.remove(entry.url);
+            total -= entry.size;
+        }
+    }
+    return total;
+}
+
+void HttpCache::forget(const QUrl &url)
+{
+    m_metaData.remove(url);
+    m_data.remove(url);
+}
+
+void HttpCache::touch(const QUrl &url)
+{
+    // the first insert lists the entries, a session that only reads does it here
+    if (!m_listed)
+        cacheSize();
+    // entries stored since the last expire() are not known, their file time is recent anyway
+    const QString path = m_files.value(url);
+    if (path.isEmpty())
+        return;
+    const QDateTime now = QDateTime::currentDateTimeUtc();
+    QFile file(path);
+    if (file.fileTime(QFileDevice::FileModificationTime).secsTo(now) < TOUCH_INTERVAL)
+        return;
+    if (file.open(QIODevice::ReadWrite | QIODevice::ExistingOnly))
+        file.setFileTime(now, QFileDevice::FileModificationTime);
+}
@@ -0,0 +1,66 @@
+/*
+ *   SPDX-FileCopyrightText:      2021 Wang Rui <wangrui@jingos.com>
+ *   SPDX-License-Identifier:     LGPL-2.1-only OR LGPL-3.0-only OR LicenseRef-KDE-Accepted-LGPL
+ */
+#ifndef HTTP_CACHE_H
+#define HTTP_CACHE_H
+
+#include <QNetworkDiskCache>
+#include <QCache>
+#include <QHash>
+#include <QUrl>
+#include <QVariantMap>
+#include "discovercommon_export.h"
+
+/**
+ * Disk cache of the responses that went through HttpClient.
+ *
+ * QNetworkDiskCache honours Cache-Control and keeps the validators (ETag,
+ * Last-Modified) next to the data, so stale entries are revalidated with a
+ * conditional request. Recently used entries are also kept in memory so that
+ * answering from the cache does not read the disk. Once the directory grows
+ * beyond maximumCacheSize() the entries that were not used for the longest
+ * time are removed first. The file time of an entry is what tells, it is
+ * refreshed when the entry is read from disk and the time is older than a few
+ * minutes, so the order is kept across restarts and shared by every HttpCache
+ * on the same directory.
+ */
+class DISCOVERCOMMON_EXPORT HttpCache : public QNetworkDiskCache
+{
+    Q_OBJECT
+public:
+    explicit HttpCache(QObject *parent = nullptr);
+    HttpCache(const QString &directory, qint64 maximumSize, QObject *parent = nullptr);
+
+    QNetworkCacheMetaData metaData(const QUrl &url) override;
+    void updateMetaData(const QNetworkCacheMetaData &metaData) override;
+    QIODevice *data(const QUrl &url) override;
+    bool remove(const QUrl &url) override;
+    QIODevice *prepare(const QNetworkCacheMetaData &metaData) override;
+    void insert(QIODevice *device) override;
+
+    /* hits, misses and bytesSaved (the size of the hits) since the cache was created */
+    QVariantMap stats() const;
+
+public Q_SLOTS:
+    void clear() override;
+
+protected:
+    qint64 expire() override;
+
+private:
+    void forget(const QUrl &url);
+    void touch(const QUrl &url);
+
+    QCache<QUrl, QNetworkCacheMetaData> m_metaData;
+    QCache<QUrl, QByteArray> m_data;
+    QHash<QIODevice*, QUrl> m_preparing;
+    qint64 m_hits = 0;
+    qint64 m_misses = 0;
+    qint64 m_bytesSaved = 0;
+    // the file of each entry, as found by expire()
+    QHash<QUrl, QString> m_files;
+    bool m_listed = false;
+};
+
+#endif // HTTP_CACHE_H
@@ -3,18 +3,43 @@
  *   SPDX-License-Identifier:     LGPL-2.1-only OR LGPL-3.0-only OR LicenseRef-KDE-Accepted-LGPL
  */
 #include "HttpClient.h"
+#include "HttpCache.h"
 #include <QJsonObject>
 #include <QJsonDocument>
 #include <QBuffer>
+#include <QRandomGenerator>
+#include <QTimer>
+#include <algorithm>
+#include <memory>
+#ifndef QT_NO_SSL
+#include <QSslConfiguration>
+#endif
 
 //using namespace AeaQt;
 
+#define LATENCY_SAMPLES 64
+#define MIN_LATENCY_SAMPLES 8
+#define MIN_TIMEOUT (3 * 1000)
+#define MIN_HEDGE_DELAY 50
+#define RETRY_DELAY 500
+#define MAX_RETRY_DELAY (8 * 1000)
+
 HttpClient::HttpClient()
 {
+    setCache(new HttpCache(this));
+    // decoding is mostly memory bound, more threads would only compete with the UI
+    m_decoderPool.setMaxThreadCount(2);
+
+    // each class only waits for its own kind, a catalog download never holds back a search
+    m_maxRunning[HttpRequest::Interactive] = 6;
+    m_maxRunning[HttpRequest::Prefetch] = 4;
+    m_maxRunning[HttpRequest::Background] = 2;
 }
 
 HttpClient::~HttpClient()
 {
+    m_decoderPool.clear();
+    m_decoderPool.waitForDone();
 }
 HttpClient *HttpClient::s_self = nullptr;
 
@@ -40,6 +65,321 @@ HttpRequest HttpClient::put(const QString &url)
     return HttpRequest(QNetworkAccessManager::PutOperation, this).url(url);
 }
 
+QThreadPool *HttpClient::decoderPool()
+{
+    return &m_decoderPool;
+}
+
+void HttpClient::preconnect(const QUrl &url)
+{
+#ifndef QT_NO_SSL
+    if (url.scheme() == QLatin1String("https")) {
+        QSslConfiguration configuration = QSslConfiguration::defaultConfiguration();
+        // offering h2 makes the warmed up connection usable by Http2AllowedAttribute requests
+        configuration.setAllowedNextProtocols({QSslConfiguration::ALPNProtocolHTTP2, QSslConfiguration::NextProtocolHttp1_1});
+        connectToHostEncrypted(url.host(), url.port(443), configuration);
+        return;
+    }
+#endif
+    connectToHost(url.host(), url.port(80));
+}
+
+HttpClient::HostStats HttpClient::hostStats(const QString &host) const
+{
+    return m_hostStats.value(host);
+}
+
+QVariantMap HttpClient::connectionStats() const
+{
+    QVariantMap ret;
+    for (auto it = m_hostStats.constBegin(); it != m_hostStats.constEnd(); ++it) {
+        const HostStats &stats = it.value();
+        const int finished = stats.requests - stats.inFlight;
+        ret.insert(it.key(), QVariantMap {
+            { QStringLiteral("requests"), stats.requests },
+            { QStringLiteral("inFlight"), stats.inFlight },
+            { QStringLiteral("handshakes"), stats.handshakes },
+            { QStringLiteral("http2"), stats.http2 },
+            { QStringLiteral("fromCache"), stats.fromCache },
+            { QStringLiteral("errors"), stats.errors },
+            { QStringLiteral("averageMs"), finished > 0 ? stats.totalMs / finished : 0 },
+        });
+    }
+    return ret;
+}
+
+QNetworkReply *HttpClient::createRequest(Operation op, const QNetworkRequest &originalRequest, QIODevice *outgoingData)
+{
+    QNetworkRequest request(originalRequest);
+    // multiplexes all the requests to a host on one connection when the server offers h2 (ALPN),
+    // otherwise Qt keeps at most 6 HTTP/1.1 connections per host alive
+    if (request.attribute(QNetworkRequest::Http2AllowedAttribute).isNull())
+        request.setAttribute(QNetworkRequest::Http2AllowedAttribute, true);
+
+    QNetworkReply *reply = QNetworkAccessManager::createRequest(op, request, outgoingData);
+    const QString host = request.url().host();
+    // connectToHost() goes through here as well, with a preconnect-http(s) scheme
+    const bool preconnect = request.url().scheme().startsWith(QLatin1String("preconnect-"));
+    if (host.isEmpty())
+        return reply;
+
+    HostStats &stats = m_hostStats[host];
+    if (!preconnect) {
+        ++stats.requests;
+        ++stats.inFlight;
+    }
+#ifndef QT_NO_SSL
+    // only emitted by the reply that completed the handshake, reused connections skip it
+    connect(reply, &QNetworkReply::encrypted, this, [this, host] {
+        ++m_hostStats[host].handshakes;
+    });
+#endif
+    if (preconnect)
+        return reply;
+
+    QElapsedTimer timer;
+    timer.start();
+    // the latency of an endpoint is its time to answer, not the time the body takes to arrive
+    auto firstByte = std::make_shared<qint64>(-1);
+    connect(reply, &QNetworkReply::metaDataChanged, this, [timer, firstByte] {
+        if (*firstByte < 0)
+            *firstByte = timer.elapsed();
+    });
+    connect(reply, &QNetworkReply::finished, this, [this, host, reply, timer, firstByte] {
+        HostStats &stats = m_hostStats[host];
+        --stats.inFlight;
+        stats.totalMs += timer.elapsed();
+        if (reply->attribute(QNetworkRequest::Http2WasUsedAttribute).toBool())
+            ++stats.http2;
+        const bool fromCache = reply->attribute(QNetworkRequest::SourceIsFromCacheAttribute).toBool();
+        if (fromCache)
+            ++stats.fromCache;
+        if (reply->error() != QNetworkReply::NoError)
+            ++stats.errors;
+        else if (!fromCache)
+            addLatency(reply->url(), *firstByte >= 0 ? *firstByte : timer.elapsed());
+    });
+    return reply;
+}
+
+HttpClient::PriorityStats HttpClient::priorityStats(HttpRequest::Priority priority) const
+{
+    return m_priorityStats[priority];
+}
+
+QVariantMap HttpClient::schedulerStats() const
+{
+    static const char *s_priorityNames[] = { "interactive", "prefetch", "background" };
+    QVariantMap ret;
+    for (int priority = 0; priority < HttpRequest::PriorityCount; ++priority) {
+        const PriorityStats &stats = m_priorityStats[priority];
+        ret.insert(QLatin1String(s_priorityNames[priority]), QVariantMap {
+            { QStringLiteral("running"), stats.running },
+            { QStringLiteral("queued"), stats.queued },
+            { QStringLiteral("maxQueued"), stats.maxQueued },
+            { QStringLiteral("started"), stats.started },
+            { QStringLiteral("averageWaitMs"), stats.started > 0 ? stats.totalWaitMs / stats.started : 0 },
+            { QStringLiteral("maxWaitMs"), stats.maxWaitMs },
+        });
+    }
+    return ret;
+}
+
+void HttpClient::setMaxRunning(HttpRequest::Priority priority, int maxRunning)
+{
+    m_maxRunning[priority] = qMax(1, maxRunning);
+    startQueued();
+}
+
+void HttpClient::schedule(QueuedRequest request)
+{
+    PriorityStats &stats = m_priorityStats[request.priority];
+    request.queued.start();
+    m_queued[request.priority].enqueue(request);
+    ++stats.queued;
+    stats.maxQueued = qMax(stats.maxQueued, stats.queued);
+    startQueued();
+}
+
+void HttpClient::startQueued()
+{
+    for (int priority = 0; priority < HttpRequest::PriorityCount; ++priority) {
+        PriorityStats &stats = m_priorityStats[priority];
+        QQueue<QueuedRequest> &queue = m_queued[priority];
+        while (stats.running < m_maxRunning[priority] && !queue.isEmpty()) {
+            const QueuedRequest request = queue.dequeue();
+            --stats.queued;
+            const qint64 waited = request.queued.isValid() ? request.queued.elapsed() : 0;
+            stats.totalWaitMs += waited;
+            stats.maxWaitMs = qMax(stats.maxWaitMs, waited);
+            startRequest(request);
+        }
+    }
+}
+
+QNetworkReply *HttpClient::sendRequest(const QueuedRequest &request)
+{
+    QBuffer *sendBuffer = new QBuffer();
+    if (!request.body.isEmpty()) {
+        sendBuffer->setData(request.body);
+    }
+    QNetworkReply *reply = createRequest(request.op, request.request, sendBuffer);
+    if (!reply) {
+        delete sendBuffer;
+        return nullptr;
+    }
+    sendBuffer->setParent(reply);
+    return reply;
+}
+
+QNetworkReply *HttpClient::launch(const QueuedRequest &request, const QByteArray &key)
+{
+    QNetworkReply *reply = sendRequest(request);
+    if (!reply)
+        return nullptr;
+
+    PriorityStats &stats = m_priorityStats[request.priority];
+    ++stats.running;
+    ++stats.started;
+    const HttpRequest::Priority priority = request.priority;
+    HttpResponse *response = request.response;
+    // replies given to the slots are not always finished before they get deleted
+    auto done = std::make_shared<bool>(false);
+    auto release = [this, priority, key, response, done] {
+        if (*done)
+            return;
+        *done = true;
+        if (!key.isEmpty() && m_inFlight.value(key) == response)
+            m_inFlight.remove(key);
+        --m_priorityStats[priority].running;
+        startQueued();
+    };
+    // connected before the response so that nothing gets attached while it is delivered
+    connect(reply, &QNetworkReply::finished, this, release);
+    connect(reply, &QObject::destroyed, this, release);
+    return reply;
+}
+
+void HttpClient::startRequest(const QueuedRequest &request)
+{
+    HttpResponse *response = request.response;
+    const QByteArray key = request.coalescingKey;
+    if (!response) {
+        m_inFlight.remove(key);
+        return;
+    }
+
+    QNetworkReply *reply = launch(request, key);
+    if (!reply) {
+        m_inFlight.remove(key);
+        delete response;
+        return;
+    }
+
+    if (request.retries > request.attempt) {
+        response->setRetryHandler([this, request](QNetworkReply *reply) {
+            return retry(request, reply);
+        });
+    } else {
+        response->setRetryHandler(nullptr);
+    }
+    const int timeout = adaptiveTimeout(request);
+    response->setNetworkReply(reply, timeout);
+
+    const int p95 = request.hedge ? latencyPercentile(request.request.url(), 95) : -1;
+    // an endpoint that answers within a few msec is not worth doubling the requests for
+    const int hedgeDelay = qMax(p95, MIN_HEDGE_DELAY);
+    if (p95 >= 0 && hedgeDelay < timeout) {
+        QPointer<QNetworkReply> primary(reply);
+        QTimer::singleShot(hedgeDelay, this, [this, request, primary, timeout] {
+            if (!primary || !primary->isRunning() || !request.response || request.response->networkReply() != primary)
+                return;
+            // it is answering already, a copy would only be slower
+            if (primary->attribute(QNetworkRequest::HttpStatusCodeAttribute).isValid())
+                return;
+            // a class that is busy already gets no extra load
+            if (m_priorityStats[request.priority].running >= m_maxRunning[request.priority])
+                return;
+            if (QNetworkReply *hedge = launch(request, QByteArray()))
+                request.response->hedge(hedge, timeout);
+        });
+    }
+}
+
+bool HttpClient::retry(const QueuedRequest &request, QNetworkReply *reply)
+{
+    bool retryable = false;
+    switch (reply->error()) {
+    case QNetworkReply::OperationCanceledError:
+        // the other aborts are on purpose, like going offline
+        retryable = reply->property("timedOut").toBool();
+        break;
+    case QNetworkReply::TimeoutError:
+    case QNetworkReply::RemoteHostClosedError:
+    case QNetworkReply::ConnectionRefusedError:
+    case QNetworkReply::TemporaryNetworkFailureError:
+    case QNetworkReply::NetworkSessionFailedError:
+    case QNetworkReply::UnknownNetworkError:
+    case QNetworkReply::InternalServerError:
+    case QNetworkReply::ServiceUnavailableError:
+    case QNetworkReply::UnknownServerError:
+        retryable = true;
+        break;
+    default:
+        break;
+    }
+    if (!retryable || !request.response) {
+        return false;
+    }
+
+    QueuedRequest next = request;
+    ++next.attempt;
+    // jittered between half and one and a half times the doubling delay, so that
+    // clients that failed together do not come back together
+    const int delay = qMin(RETRY_DELAY << request.attempt, MAX_RETRY_DELAY);
+    const int jittered = delay / 2 + QRandomGenerator::global()->bounded(delay);
+    request.response->setParent(this);
+    reply->deleteLater();
+    QTimer::singleShot(jittered, this, [this, next] {
+        startRequest(next);
+    });
+    return true;
+}
+
+int HttpClient::adaptiveTimeout(const QueuedRequest &request) const
+{
+    const int ceiling = request.timeout > 0 ? request.timeout : 60 * 1000;
+    const int p95 = latencyPercentile(request.request.url(), 95);
+    if (p95 < 0)
+        return ceiling;
+    // a slow answer is still an answer, only the ones far outside the usual get cut off;
+    // the timeout is restarted by every chunk, the body can take as long as it keeps coming
+    return qBound(qMin(MIN_TIMEOUT, ceiling), p95 * 4, ceiling);
+}
+
+static QString endpoint(const QUrl &url)
+{
+    return url.adjusted(QUrl::RemoveUserInfo | QUrl::RemoveQuery | QUrl::RemoveFragment).toString();
+}
+
+void HttpClient::addLatency(const QUrl &url, int msec)
+{
+    QVector<int> &latencies = m_latencies[endpoint(url)];
+    if (latencies.size() >= LATENCY_SAMPLES)
+        latencies.removeFirst();
+    latencies.append(msec);
+}
+
+int HttpClient::latencyPercentile(const QUrl &url, int percentile) const
+{
+    QVector<int> latencies = m_latencies.value(endpoint(url));
+    if (latencies.size() < MIN_LATENCY_SAMPLES)
+        return -1;
+    const int index = qMin(latencies.size() - 1, latencies.size() * percentile / 100);
+    std::nth_element(latencies.begin(), latencies.begin() + index, latencies.end());
+    return latencies.at(index);
+}
+
 HttpRequest HttpClient::send(const QString &url, QNetworkAccessManager::Operation op)
 {
     return HttpRequest(op, this).url(url);
@@ -9,6 +9,11 @@
 #include "HttpResponse.h"
 #include <QNetworkRequest>
 #include <QNetworkReply>
+#include <QThreadPool>
+#include <QQueue>
+#include <QElapsedTimer>
+#include <QPointer>
+#include <QVariantMap>
 #include "discovercommon_export.h"
 //https://search.deepinos.org.cn/
 #define BASE_URL "https://appapi.jingos.com/v1/"
@@ -30,6 +35,90 @@ public:
     HttpRequest send(const QString &url, Operation op = GetOperation);
     static HttpClient* s_self;
 
+    /* Where HttpRequest::onDecoded() decoders run */
+    QThreadPool *decoderPool();
+
+    /*
+     * @preconnect: Opens the connection to the host of @url (TLS handshake and
+     *              HTTP/2 negotiation included) ahead of the first request.
+     *              The connection stays in the keep-alive pool of this client.
+     */
+    void preconnect(const QUrl &url);
+
+    struct HostStats {
+        int requests = 0;
+        int inFlight = 0;
+        int handshakes = 0;   // replies that had to open a new TLS connection
+        int http2 = 0;
+        int fromCache = 0;
+        int errors = 0;
+        qint64 totalMs = 0;   // of the finished requests, queueing included
+    };
+    HostStats hostStats(const QString &host) const;
+    /* hostStats() of every host contacted so far, for debugging */
+    Q_INVOKABLE QVariantMap connectionStats() const;
+
+    struct PriorityStats {
+        int running = 0;
+        int queued = 0;
+        int maxQueued = 0;
+        int started = 0;
+        qint64 totalWaitMs = 0;
+        qint64 maxWaitMs = 0;
+    };
+    PriorityStats priorityStats(HttpRequest::Priority priority) const;
+    /* priorityStats() of every HttpRequest::Priority, for debugging */
+    Q_INVOKABLE QVariantMap schedulerStats() const;
+    /* How many requests of @priority are sent at the same time, the others wait */
+    void setMaxRunning(HttpRequest::Priority priority, int maxRunning);
+
+    /*
+     * @latencyPercentile: Time until the headers arrived, of the last answers
+     *                     of the endpoint (@url without its query) that came
+     *                     from the network, -1 until there are enough of them.
+     *                     The size of the body does not count, a large download
+     *                     does not skew the small ones and the other way around.
+     */
+    int latencyPercentile(const QUrl &url, int percentile) const;
+
+protected:
+    QNetworkReply *createRequest(Operation op, const QNetworkRequest &request, QIODevice *outgoingData = nullptr) override;
+
+private:
+    struct QueuedRequest {
+        Operation op;
+        QNetworkRequest request;
+        QByteArray body;
+        QPointer<HttpResponse> response;
+        HttpRequest::Priority priority;
+        QByteArray coalescingKey;
+        QElapsedTimer queued;
+        int timeout = -1;
+        int retries = 0;
+        int attempt = 0;
+        bool hedge = false;
+    };
+    void schedule(QueuedRequest request);
+    void startQueued();
+    void startRequest(const QueuedRequest &request);
+    QNetworkReply *sendRequest(const QueuedRequest &request);
+    /* sendRequest() counted as running in its class until the reply is done, @key is released then */
+    QNetworkReply *launch(const QueuedRequest &request, const QByteArray &key);
+    bool retry(const QueuedRequest &request, QNetworkReply *reply);
+    int adaptiveTimeout(const QueuedRequest &request) const;
+    void addLatency(const QUrl &url, int msec);
+
+    QQueue<QueuedRequest> m_queued[HttpRequest::PriorityCount];
+    PriorityStats m_priorityStats[HttpRequest::PriorityCount];
+    int m_maxRunning[HttpRequest::PriorityCount];
+    /* The last network latencies of each endpoint, oldest first */
+    QHash<QString, QVector<int>> m_latencies;
+    /* Requests per host, see HostStats */
+    QHash<QString, HostStats> m_hostStats;
+    /* Identical requests still waiting for their reply, see HttpRequest::coalescingKey() */
+    QHash<QByteArray, HttpResponse*> m_inFlight;
+    QThreadPool m_decoderPool;
+
 };
 
 //}
@@ -7,8 +7,10 @@
 
 #include <QJsonDocument>
 #include <QUrlQuery>
-#include <QBuffer>
 #include <QMetaEnum>
+#include <QAbstractNetworkCache>
+#include <QCryptographicHash>
+#include <resources/ResourcesModel.h>
 
 //using namespace AeaQt;
 
@@ -132,58 +134,42 @@ HttpRequest &HttpRequest::body(const QVariant &body)
 
 HttpRequest &HttpRequest::onResponse(const QObject *receiver, const char *slot, HttpResponse::SupportMethod type)
 {
-    m_slotsMap.insert(type, {slot, QVariant::fromValue((QObject *)receiver)});
+    m_handlers.receivers += { receiver, slot, type };
     return *this;
 }
 
-HttpRequest &HttpRequest::onResponse(std::function<void (QNetworkReply *)> lambda)
-{
-    return onResponse(QVariant::fromValue(lambda));
-}
-
-HttpRequest &HttpRequest::onResponse(std::function<void (QVariantMap)> lambda)
-{
-    return onResponse(QVariant::fromValue(lambda));
-}
-
-HttpRequest &HttpRequest::onResponse(std::function<void (QByteArray)> lambda)
-{
-    return onResponse(QVariant::fromValue(lambda));
-}
-
-HttpRequest &HttpRequest::onResponse(std::function<void (qint64, qint64)> lambda)
-{
-    return onResponse(QVariant::fromValue(lambda));
-}
-
 HttpRequest &HttpRequest::onError(const QObject *receiver, const char *slot)
 {
     return onResponse(receiver, slot, HttpResponse::AutoInfer);
 }
 
-HttpRequest &HttpRequest::onError(std::function<void (QNetworkReply::NetworkError)> lambda)
+HttpRequest &HttpRequest::timeout(const int &msec)
 {
-    return onResponse(QVariant::fromValue(lambda));
+    m_timeout = msec;
+    return *this;
 }
 
-HttpRequest &HttpRequest::onError(std::function<void (QString)> lambda)
+HttpRequest &HttpRequest::cachePolicy(CachePolicy policy)
 {
-    return onResponse(QVariant::fromValue(lambda));
+    m_cachePolicy = policy;
+    return *this;
 }
 
-HttpRequest &HttpRequest::onError(std::function<void (QNetworkReply::NetworkError, QNetworkReply *)> lambda)
+HttpRequest &HttpRequest::retries(int retries)
 {
-    return onResponse(QVariant::fromValue(lambda));
+    m_retries = qMax(0, retries);
+    return *this;
 }
 
-HttpRequest &HttpRequest::onError(std::function<void (QString, QNetworkReply *)> lambda)
+HttpRequest &HttpRequest::hedged(bool hedge)
 {
-    return onResponse(QVariant::fromValue(lambda));
+    m_hedge = hedge;
+    return *this;
 }
 
-HttpRequest &HttpRequest::timeout(const int &msec)
+HttpRequest &HttpRequest::priority(Priority priority)
 {
-    m_timeout = msec;
+    m_priority = priority;
     return *this;
 }
 
@@ -199,22 +185,9 @@ HttpRequest &HttpRequest::removePublicQueryParams()
     return *this;
 }
 
-HttpRequest &HttpRequest::onResponse(QVariant lambda)
-{
-    m_slotsMap.insert(HttpResponse::AutoInfer, {lambda.typeName(), lambda});
-
-    return *this;
-}
-
 HttpResponse *HttpRequest::exec()
 {
-    QNetworkReply* reply = NULL;
-
     insertPublicQueryParams();
-    QBuffer* sendBuffer = new QBuffer();
-    if (! m_body.isEmpty()) {
-        sendBuffer->setData(m_body);
-    }
 
     log_debugger += "Http Client info: ";
     log_debugger += "Type: " + QString(s_httpOperation[m_op]);
@@ -229,17 +202,129 @@ HttpResponse *HttpRequest::exec()
     log_debugger += "Header: " + headers;
     log_debugger += "Send buffer(Body):\r\n" + m_body;
 
-    reply = m_httpService->createRequest(m_op, m_networkRequest, sendBuffer);
+    const bool coalesce = canCoalesce();
+    const QByteArray key = coalesce ? coalescingKey() : QByteArray();
+    if (coalesce) {
+        if (HttpResponse *response = m_httpService->m_inFlight.value(key)) {
+            response->attach(m_handlers);
+            return response;
+        }
+    }
+
+    applyCachePolicy();
+    // Qt's own queue for a host goes by the same order
+    static const QNetworkRequest::Priority s_networkPriority[] = {
+        QNetworkRequest::HighPriority,
+        QNetworkRequest::NormalPriority,
+        QNetworkRequest::LowPriority
+    };
+    m_networkRequest.setPriority(s_networkPriority[m_priority]);
+
+    HttpResponse *response = new HttpResponse(m_httpService, m_handlers, m_timeout, m_isBlock);
+    if (coalesce)
+        m_httpService->m_inFlight.insert(key, response);
+
+    HttpClient::QueuedRequest request;
+    request.op = m_op;
+    request.request = m_networkRequest;
+    request.body = m_body;
+    request.response = response;
+    request.priority = m_priority;
+    request.coalescingKey = key;
+    request.timeout = m_timeout;
+    // sending the same request twice must not change anything on the server
+    const bool idempotent = m_op == QNetworkAccessManager::GetOperation || m_op == QNetworkAccessManager::HeadOperation;
+    request.retries = idempotent && !m_isBlock ? m_retries : 0;
+    request.hedge = idempotent && !m_isBlock && m_hedge;
+    // a blocking request would wait for the queue in its own event loop
+    if (m_isBlock)
+        m_httpService->startRequest(request);
+    else
+        m_httpService->schedule(request);
+    return response;
+}
+
+QThreadPool *HttpRequest::decoderPool() const
+{
+    return m_httpService->decoderPool();
+}
+
+bool HttpRequest::canCoalesce() const
+{
+    if (m_isBlock || (m_op != QNetworkAccessManager::GetOperation && m_op != QNetworkAccessManager::HeadOperation))
+        return false;
 
-    if (reply == NULL) {
-        sendBuffer->deleteLater();
-        return NULL;
+    // the reply can only be read once and slots are connected to a single response
+    return !m_handlers.reply && m_handlers.receivers.isEmpty();
+}
+
+QByteArray HttpRequest::coalescingKey() const
+{
+    return QByteArray::number(m_op) + ' '
+         + QByteArray::number(m_cachePolicy) + ' '
+         + m_networkRequest.url().toEncoded() + ' '
+         + QCryptographicHash::hash(m_body, QCryptographicHash::Sha1).toHex();
+}
+
+void HttpRequest::applyCachePolicy()
+{
+    switch (m_cachePolicy) {
+    case NoCache:
+        m_networkRequest.setAttribute(QNetworkRequest::CacheLoadControlAttribute, QNetworkRequest::AlwaysNetwork);
+        m_networkRequest.setAttribute(QNetworkRequest::CacheSaveControlAttribute, false);
+        break;
+    case NetworkFirst:
+        m_networkRequest.setAttribute(QNetworkRequest::CacheLoadControlAttribute, QNetworkRequest::PreferNetwork);
+        break;
+    case CacheFirst:
+        m_networkRequest.setAttribute(QNetworkRequest::CacheLoadControlAttribute, QNetworkRequest::PreferCache);
+        break;
+    case CacheOnly:
+        m_networkRequest.setAttribute(QNetworkRequest::CacheLoadControlAttribute, QNetworkRequest::AlwaysCache);
+        break;
+    case StaleWhileRevalidate: {
+        QAbstractNetworkCache *cache = m_httpService->cache();
+        if (m_op != QNetworkAccessManager::GetOperation || !cache || !cache->metaData(m_networkRequest.url()).isValid()) {
+            m_networkRequest.setAttribute(QNetworkRequest::CacheLoadControlAttribute, QNetworkRequest::PreferNetwork);
+            break;
+        }
+
+        revalidate();
+        m_networkRequest.setAttribute(QNetworkRequest::CacheLoadControlAttribute, QNetworkRequest::AlwaysCache);
+        break;
     }
-    else {
-        sendBuffer->setParent(reply);
     }
+}
 
-    return new HttpResponse(reply, m_slotsMap, m_timeout, m_isBlock);
+void HttpRequest::revalidate()
+{
+    // the cached answer is all there is while offline
+    if (ResourcesModel::global()->networkState() == "1")
+        return;
+
+    // nobody waits for this one, it only updates the cache for the next request.
+    // If the entry is still fresh it does not even reach the server.
+    QNetworkRequest revalidation(m_networkRequest);
+    revalidation.setAttribute(QNetworkRequest::CacheLoadControlAttribute, QNetworkRequest::PreferNetwork);
+    revalidation.setPriority(QNetworkRequest::LowPriority);
+    const QByteArray key = "revalidate " + revalidation.url().toEncoded();
+    if (m_httpService->m_inFlight.contains(key))
+        return;
+
+    HttpResponseHandlers handlers;
+    handlers.reply = [](QNetworkReply *reply) { reply->deleteLater(); };
+    handlers.error = [](QNetworkReply::NetworkError) {};
+    HttpResponse *response = new HttpResponse(m_httpService, handlers, m_timeout, false);
+    m_httpService->m_inFlight.insert(key, response);
+
+    HttpClient::QueuedRequest request;
+    request.op = QNetworkAccessManager::GetOperation;
+    request.request = revalidation;
+    request.response = response;
+    request.priority = Background;
+    request.coalescingKey = key;
+    request.timeout = m_timeout;
+    m_httpService->schedule(request);
 }
 
 void HttpRequest::insertPublicQueryParams()
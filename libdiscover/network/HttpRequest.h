@@ -11,6 +11,10 @@
 #include <QNetworkAccessManager>
 #include <QJsonObject>
 #include <QDebug>
+#include <QFutureWatcher>
+#include <QPointer>
+#include <QtConcurrent/QtConcurrentRun>
+#include <type_traits>
 #include "discovercommon_export.h"
 
 //namespace AeaQt {
@@ -31,6 +35,25 @@
 
 class HttpClient;
 
+/* The std::function a lambda is kept as, worked out from its call operator */
+template<typename Functor>
+struct HttpHandlerTraits : HttpHandlerTraits<decltype(&Functor::operator())> {};
+
+template<typename Class, typename Result, typename... Args>
+struct HttpHandlerTraits<Result (Class::*)(Args...) const>
+{
+    using Function = std::function<void (typename std::decay<Args>::type...)>;
+};
+
+template<typename Class, typename Result, typename... Args>
+struct HttpHandlerTraits<Result (Class::*)(Args...)> : HttpHandlerTraits<Result (Class::*)(Args...) const> {};
+
+template<typename Result, typename... Args>
+struct HttpHandlerTraits<Result (*)(Args...)>
+{
+    using Function = std::function<void (typename std::decay<Args>::type...)>;
+};
+
 class DISCOVERCOMMON_EXPORT HttpRequest
 {
 public:
@@ -40,6 +63,21 @@ public:
         Raw_Text_Json, // application/json
     };
 
+    enum CachePolicy {
+        NoCache = 0, // Always ask the server, the response is not stored.
+        NetworkFirst, // Default. Fresh cached responses are used, stale ones are revalidated first.
+        CacheFirst, // Any cached response is used, the server is only asked when there is none.
+        CacheOnly, // Only the cache is used, fails when there is nothing cached.
+        StaleWhileRevalidate, // Any cached response is used, the cache is refreshed at Background priority for the next time.
+    };
+
+    enum Priority {
+        Interactive = 0, // Default. Someone is waiting for it, e.g. a search or the page being shown.
+        Prefetch, // Will be shown soon, e.g. banners and icons.
+        Background, // Nobody waits for it, e.g. catalog refreshes and reports.
+        PriorityCount
+    };
+
     explicit HttpRequest(QNetworkAccessManager::Operation op, HttpClient *jsonHttpClient);
     virtual ~HttpRequest();
 
@@ -61,14 +99,45 @@ public:
     /*
      * @onRespone slot support type: void function(QVariantMap resultMap) OR
      *                               void function(QByteArray resultData) OR
-     *                               void function(QNetworkReply* reply)
-     * note: The same type is only triggered once
+     *                               void function(QNetworkReply* reply) OR
+     *                               void function(qint64 bytesReceived, qint64 bytesTotal)
+     * note: The same type is only triggered once. The type of a lambda is
+     *       resolved at compile time, any other one does not build.
      */
     HttpRequest &onResponse(const QObject *receiver, const char *slot, HttpResponse::SupportMethod type = HttpResponse::AutoInfer);
-    HttpRequest &onResponse(std::function<void (QNetworkReply*)> lambda);
-    HttpRequest &onResponse(std::function<void (QVariantMap)> lambda);
-    HttpRequest &onResponse(std::function<void (QByteArray)> lambda);
-    HttpRequest &onResponse(std::function<void (qint64, qint64)> lambda);
+    template<typename Functor>
+    HttpRequest &onResponse(Functor &&lambda)
+    {
+        m_handlers.setResponse(typename HttpHandlerTraits<typename std::decay<Functor>::type>::Function(std::forward<Functor>(lambda)));
+        return *this;
+    }
+    /*
+     * @onDecoded: @decoder turns the response data into a typed result on one of
+     *             HttpClient's decoder threads, so big documents are not parsed
+     *             in the GUI thread. @handler is then called with that result
+     *             in the thread of the request, unless @context is gone by then.
+     * note: Takes the place of the QByteArray response slot
+     */
+    template<typename Decoder, typename Handler>
+    HttpRequest &onDecoded(QObject *context, Decoder decoder, Handler handler)
+    {
+        using Result = typename std::decay<decltype(decoder(QByteArray()))>::type;
+        QThreadPool *pool = decoderPool();
+        QPointer<QObject> guard(context);
+        return onResponse([pool, guard, decoder, handler](QByteArray data) {
+            if (!guard)
+                return;
+            auto watcher = new QFutureWatcher<Result>(guard.data());
+            QObject::connect(watcher, &QFutureWatcherBase::finished, watcher, [watcher, handler] {
+                handler(watcher->result());
+                watcher->deleteLater();
+            });
+            watcher->setFuture(QtConcurrent::run(pool, [decoder, data] {
+                return decoder(data);
+            }));
+        });
+    }
+
     /*
      * @onError slot support type: void function(QNetworkReply::NetworkError error)
      *                             void function(QString errorString);
@@ -77,17 +146,48 @@ public:
      * note: The same type is only triggered once
      */
     HttpRequest &onError(const QObject *receiver, const char *slot);
-    HttpRequest &onError(std::function<void (QNetworkReply::NetworkError)> lambda);
-    HttpRequest &onError(std::function<void (QString)> lambda);
-    HttpRequest &onError(std::function<void (QNetworkReply::NetworkError, QNetworkReply*)> lambda);
-    HttpRequest &onError(std::function<void (QString, QNetworkReply*)> lambda);
+    template<typename Functor>
+    HttpRequest &onError(Functor &&lambda)
+    {
+        m_handlers.setError(typename HttpHandlerTraits<typename std::decay<Functor>::type>::Function(std::forward<Functor>(lambda)));
+        return *this;
+    }
 
     /**
-     * @brief msec <= 0, disable timeout
-     *        msec >  0, enable timeout
+     * @brief How long the reply may go without progress before it is aborted.
+     *        msec <= 0, at most a minute
+     *        msec >  0, at most msec
+     *        Once an endpoint answered often enough, it gets a few times its
+     *        p95 latency instead when that is shorter. A body that keeps
+     *        arriving is never cut off.
      */
     HttpRequest &timeout(const int &msec = -1);
 
+    /**
+     * @brief How often a GET or HEAD is sent again after a timeout, a
+     *        connection problem or a server error, waiting a jittered,
+     *        doubling delay in between. Other operations are not retried.
+     */
+    HttpRequest &retries(int retries);
+
+    /**
+     * @brief A GET still waiting for its answer after the p95 latency of its
+     *        endpoint is sent a second time, unless its priority class is busy.
+     *        The first reply that succeeds is used, a failing one yields to
+     *        the other one.
+     */
+    HttpRequest &hedged(bool hedge = true);
+
+    /**
+     * @brief How the responses stored by HttpClient's cache are used, see CachePolicy
+     */
+    HttpRequest &cachePolicy(CachePolicy policy);
+
+    /**
+     * @brief Which of HttpClient's queues the request waits in, see Priority
+     */
+    HttpRequest &priority(Priority priority);
+
     /**
      * @brief Block current thread, entering an event loop.
      */
@@ -100,7 +200,11 @@ public:
 
 private:
     HttpRequest();
-    HttpRequest &onResponse(QVariant lambda);
+    void applyCachePolicy();
+    void revalidate();
+    QThreadPool *decoderPool() const;
+    bool canCoalesce() const;
+    QByteArray coalescingKey() const;
 
 private:
     QNetworkRequest                  m_networkRequest;
@@ -109,8 +213,12 @@ private:
     HttpClient                      *m_httpService;
     int                              m_timeout;
     bool                             m_isBlock = false;
-    QMultiMap<HttpResponse::SupportMethod, QPair<QString, QVariant>> m_slotsMap;
+    HttpResponseHandlers             m_handlers;
     bool m_isInsertPublic = true;
+    CachePolicy m_cachePolicy = NetworkFirst;
+    Priority m_priority = Interactive;
+    int m_retries = 2;
+    bool m_hedge = false;
 };
 
 //}
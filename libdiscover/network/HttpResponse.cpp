@@ -4,8 +4,6 @@
  */
 #include "HttpResponse.h"
 
-#include <QRegExp>
-#include <QStringList>
 #include <QByteArray>
 #include <QNetworkConfigurationManager>
 #include <QMetaEnum>
@@ -14,131 +12,103 @@
 #include <QJsonObject>
 #include <resources/ResourcesModel.h>
 
-#define T2S(t) (QString(#t).remove(QRegExp("\\s"))) //type to string
-
-#define _exec(target, type, arg) \
-        if (target.canConvert<std::function<void (type)> >()) { \
-            std::function<void (type)> func = target.value<std::function<void (type)> >(); func(arg); \
-        } \
-        else
+//using namespace AeaQt;
 
-#define _exec2(target, type1, type2, arg1, arg2) \
-        if (target.canConvert<std::function<void (type1, type2)> >()) { \
-            std::function<void (type1, type2)> func = target.value<std::function<void (type1, type2)> >(); func(arg1, arg2); \
-        } else
+#define DEFAULT_TIMEOUT (60 * 1000)
 
-//using namespace AeaQt;
+/* the signal QObject slots of this SupportMethod are connected to */
+static const char *supportMethodSignal(int supportMethod)
+{
+    switch (supportMethod) {
+    case HttpResponse::onResponse_QNetworkReply_A_Pointer:
+        return SIGNAL(finished(QNetworkReply*));
+    case HttpResponse::onResponse_QByteArray:
+        return SIGNAL(finished(QByteArray));
+    case HttpResponse::onResponse_QVariantMap:
+        return SIGNAL(finished(QVariantMap));
+    case HttpResponse::onDownloadProgress_qint64_qint64:
+        return SIGNAL(downloadProgress(qint64, qint64));
+    case HttpResponse::onError_QNetworkReply_To_NetworkError:
+        return SIGNAL(error(QNetworkReply::NetworkError));
+    case HttpResponse::onError_QString:
+        return SIGNAL(error(QString));
+    case HttpResponse::onError_QNetworkReply_To_NetworkError_QNetworkReply_A_Pointer:
+        return SIGNAL(error(QNetworkReply::NetworkError, QNetworkReply*));
+    case HttpResponse::onError_QString_QNetworkReply_A_Poniter:
+        return SIGNAL(error(QString, QNetworkReply*));
+    }
+    return nullptr;
+}
 
-static const QMap<HttpResponse::SupportMethod, QMap<QString, QVariant>> methodParams =
+static QByteArray argumentTypes(const char *member)
 {
-    {
-        HttpResponse::onResponse_QNetworkReply_A_Pointer,
-        {
-            {"types", QStringList({T2S(QNetworkReply*)})},
-            {"lambda", T2S(std::function<void (QNetworkReply*)>)},
-            {"signal", SIGNAL(finished(QNetworkReply*))},
-            {"isAutoInfer", true}
-        }
-    },
-    {
-        HttpResponse::onResponse_QByteArray,
-        {
-            {"types", QStringList({T2S(QByteArray)})},
-            {"lambda", T2S(std::function<void (QByteArray)>)},
-            {"signal", SIGNAL(finished(QByteArray))},
-            {"isAutoInfer", true}
-        }
-    },
-    {
-        HttpResponse::onResponse_QVariantMap,
-        {
-            {"types", QStringList({T2S(QVariantMap)})},
-            {"lambda", T2S(std::function<void (QVariantMap)>)},
-            {"signal", SIGNAL(finished(QVariantMap))},
-            {"isAutoInfer", true}
-        }
-    },
-    {
-        HttpResponse::onDownloadProgress_qint64_qint64,
-        {
-            {"types", QStringList({T2S(qint64), T2S(qint64)})},
-            {"lambda", T2S(std::function<void (qint64, qint64)>)},
-            {"signal", SIGNAL(downloadProgress(qint64, qint64))},
-            {"isAutoInfer", true}
-        }
-    },
-    {
-        HttpResponse::onError_QNetworkReply_To_NetworkError,
-        {
-            {"types", QStringList({T2S(QNetworkReply::NetworkError)})},
-            {"lambda", T2S(std::function<void (QNetworkReply::NetworkError)>)},
-            {"signal", SIGNAL(error(QNetworkReply::NetworkError))},
-            {"isAutoInfer", true}
-        }
-    },
-    {
-        HttpResponse::onError_QString,
-        {
-            {"types", QStringList({T2S(QString)})},
-            {"lambda", T2S(std::function<void (QString)>)},
-            {"signal", SIGNAL(error(QString))},
-            {"isAutoInfer", true}
-        }
-    },
-    {
-        HttpResponse::onError_QNetworkReply_To_NetworkError_QNetworkReply_A_Pointer,
-        {
-            {"types", QStringList({T2S(QNetworkReply::NetworkError), T2S(QNetworkReply*)})},
-            {"lambda", T2S(std::function<void (QNetworkReply::NetworkError, QNetworkReply*)>)},
-            {"signal", SIGNAL(error(QNetworkReply::NetworkError, QNetworkReply*))},
-            {"isAutoInfer", true}
-        }
-    },
-    {
-        HttpResponse::onError_QString_QNetworkReply_A_Poniter,
-        {
-            {"types", QStringList({T2S(QString), T2S(QNetworkReply*)})},
-            {"lambda", T2S(std::function<void (QString, QNetworkReply*)>)},
-            {"signal", SIGNAL(error(QString, QNetworkReply*))},
-            {"isAutoInfer", true}
-        }
-    },
-};
+    /* skip the QMETHOD_CODE/QSLOT_CODE/QSIGNAL_CODE prefix */
+    const QByteArray signature = QMetaObject::normalizedSignature(member + 1);
+    return signature.mid(signature.indexOf('('));
+}
 
-static int extractCode(const char *member)
+/* from the slot signature get [SupportMethod] */
+static HttpResponse::SupportMethod inferSupportMethod(const QByteArray &slot)
 {
-    /* extract code, ensure QMETHOD_CODE <= code <= QSIGNAL_CODE */
-    return (((int)(*member) - '0') & 0x3);
+    const QByteArray types = argumentTypes(slot.constData());
+    for (int supportMethod = HttpResponse::onResponse_QNetworkReply_A_Pointer;
+         supportMethod <= HttpResponse::onError_QString_QNetworkReply_A_Poniter; ++supportMethod) {
+        if (argumentTypes(supportMethodSignal(supportMethod)) == types)
+            return HttpResponse::SupportMethod(supportMethod);
+    }
+    return HttpResponse::Invalid;
 }
 
 HttpResponse::HttpResponse(QNetworkReply *networkReply,
-                           const QMultiMap<SupportMethod, QPair<QString, QVariant> > &slotsMap,
+                           const HttpResponseHandlers &handlers,
                            const int &timeout,
                            bool isBlock)
-    : m_networkReply(networkReply),
-      m_slotsMap(slotsMap),
-      QObject(networkReply)
+    : HttpResponse(static_cast<QObject*>(networkReply), handlers, timeout, isBlock)
 {
-    slotsMapOperation(m_slotsMap);
-    new HttpResponseTimeout(networkReply, 60 * 1000);
+    setNetworkReply(networkReply, timeout);
+}
+
+HttpResponse::HttpResponse(QObject *parent,
+                           const HttpResponseHandlers &handlers,
+                           const int &timeout,
+                           bool isBlock)
+    : QObject(parent),
+      m_handlers(handlers),
+      m_timeout(timeout),
+      m_isBlock(isBlock)
+{
+    connectReceivers(m_handlers);
 
-    connect(m_networkReply, SIGNAL(finished()), this, SLOT(onFinished()));
-    connect(m_networkReply, SIGNAL(error(QNetworkReply::NetworkError)), this, SLOT(onError(QNetworkReply::NetworkError)));
-    connect(m_networkReply, SIGNAL(downloadProgress(qint64,qint64)), this, SLOT(onDownloadProgress(qint64, qint64)));
     connect(ResourcesModel::global(),&ResourcesModel::networkStateChanged, this, [this](QString state) {
-        if (state == "1") {
+        // answered by the cache, going offline does not matter
+        if (state == "1" && m_networkReply && !isCacheOnly(m_networkReply)) {
+            // first, so that the request does not fall back to it
+            if (m_hedge && m_hedge->isRunning())
+                m_hedge->abort();
             if (m_networkReply->isRunning()) {
                 m_networkReply->abort();
                 m_networkReply->deleteLater();
             }
         }
     });
-    if (isBlock) {
+}
+
+void HttpResponse::setNetworkReply(QNetworkReply *networkReply, int timeout)
+{
+    if (m_networkReply)
+        m_networkReply->disconnect(this);
+    setParent(networkReply);
+    m_networkReply = networkReply;
+    new HttpResponseTimeout(networkReply, timeout > 0 ? timeout : DEFAULT_TIMEOUT);
+
+    connectReply();
+    const bool cacheOnly = isCacheOnly(networkReply);
+    if (m_isBlock) {
         QEventLoop loop;
         QObject::connect(m_networkReply, SIGNAL(finished()), &loop, SLOT(quit()));
         loop.exec();
     }
-    if (ResourcesModel::global()->networkState() == "1") {
+    if (ResourcesModel::global()->networkState() == "1" && !cacheOnly) {
         if (m_networkReply->isRunning()) {
             m_networkReply->abort();
             m_networkReply->deleteLater();
@@ -150,40 +120,139 @@ HttpResponse::~HttpResponse()
 {
 }
 
+void HttpResponse::connectReply()
+{
+    connect(m_networkReply, SIGNAL(finished()), this, SLOT(onFinished()));
+    connect(m_networkReply, SIGNAL(error(QNetworkReply::NetworkError)), this, SLOT(onError(QNetworkReply::NetworkError)));
+    connect(m_networkReply, SIGNAL(downloadProgress(qint64,qint64)), this, SLOT(onDownloadProgress(qint64, qint64)));
+}
+
+bool HttpResponse::isCacheOnly(QNetworkReply *reply)
+{
+    return reply->request().attribute(QNetworkRequest::CacheLoadControlAttribute).toInt() == QNetworkRequest::AlwaysCache;
+}
+
+void HttpResponse::setRetryHandler(std::function<bool (QNetworkReply*)> &&retry)
+{
+    m_retry = std::move(retry);
+}
+
+void HttpResponse::hedge(QNetworkReply *hedge, int timeout)
+{
+    QNetworkReply *primary = m_networkReply;
+    m_hedge = hedge;
+    new HttpResponseTimeout(hedge, timeout > 0 ? timeout : DEFAULT_TIMEOUT);
+    connect(hedge, &QNetworkReply::finished, this, [this, hedge] {
+        // the primary failed and handed over to it, the usual slots take care of it
+        if (m_networkReply == hedge)
+            return;
+        m_hedge = nullptr;
+        if (hedge->error() != QNetworkReply::NoError || !m_networkReply || !m_networkReply->isRunning()) {
+            hedge->deleteLater();
+            return;
+        }
+        // the copy won, the response moves over to it before the slow one goes away
+        QNetworkReply *slow = m_networkReply;
+        slow->disconnect(this);
+        setParent(hedge);
+        m_networkReply = hedge;
+        slow->abort();
+        slow->deleteLater();
+        onFinished();
+    });
+    connect(primary, &QNetworkReply::finished, this, [this, primary, hedge] {
+        // only an answer makes the copy useless, a failing primary yields to it in onError()
+        if (m_networkReply == primary && primary->error() == QNetworkReply::NoError && m_hedge == hedge) {
+            m_hedge = nullptr;
+            hedge->abort();
+            hedge->deleteLater();
+        }
+    });
+}
+
 QNetworkReply *HttpResponse::networkReply()
 {
     return m_networkReply;
 }
 
+void HttpResponse::attach(const HttpResponseHandlers &handlers)
+{
+    HttpResponseHandlers attached = handlers;
+    connectReceivers(attached);
+    m_coalesced += attached;
+}
+
+void HttpResponse::connectReceivers(HttpResponseHandlers &handlers)
+{
+    for (const auto &receiver : qAsConst(handlers.receivers)) {
+        const SupportMethod supportMethod = receiver.type == AutoInfer ? inferSupportMethod(receiver.slot) : SupportMethod(receiver.type);
+        const char *signal = supportMethodSignal(supportMethod);
+        if (!signal) {
+            qDebug()<<"Not find support Method!"<<receiver.slot;
+            continue;
+        }
+        connect(this, signal, receiver.receiver, receiver.slot.constData(), Qt::QueuedConnection);
+
+        // the signal is what calls the slot
+        switch (supportMethod) {
+        case onResponse_QNetworkReply_A_Pointer:
+            handlers.reply = [this](QNetworkReply *reply) { emit finished(reply); };
+            break;
+        case onResponse_QByteArray:
+            handlers.data = [this](QByteArray data) { emit finished(data); };
+            break;
+        case onResponse_QVariantMap:
+            handlers.map = [this](QVariantMap map) { emit finished(map); };
+            break;
+        case onDownloadProgress_qint64_qint64:
+            handlers.downloadProgress = [this](qint64 bytesReceived, qint64 bytesTotal) { emit downloadProgress(bytesReceived, bytesTotal); };
+            break;
+        case onError_QNetworkReply_To_NetworkError:
+            handlers.error = [this](QNetworkReply::NetworkError error) { emit this->error(error); };
+            break;
+        case onError_QString:
+            handlers.errorString = [this](QString errorString) { emit this->error(errorString); };
+            break;
+        case onError_QNetworkReply_To_NetworkError_QNetworkReply_A_Pointer:
+            handlers.errorReply = [this](QNetworkReply::NetworkError error, QNetworkReply *reply) { emit this->error(error, reply); };
+            break;
+        case onError_QString_QNetworkReply_A_Poniter:
+            handlers.errorStringReply = [this](QString errorString, QNetworkReply *reply) { emit this->error(errorString, reply); };
+            break;
+        default:
+            break;
+        }
+    }
+    handlers.receivers.clear();
+}
+
 void HttpResponse::onFinished()
 {
     QNetworkReply *reply = m_networkReply;
     if (reply->error() != QNetworkReply::NoError)
         return;
 
-    if (m_slotsMap.contains(onResponse_QNetworkReply_A_Pointer)) {
-        _exec(m_slotsMap.value(onResponse_QNetworkReply_A_Pointer).second, QNetworkReply*, reply) {
-            emit finished(reply);
-        }
+    if (m_handlers.reply) {
+        m_handlers.reply(reply);
     }
-    else if (m_slotsMap.contains((onResponse_QByteArray))) {
+    else if (m_handlers.data || m_handlers.map || !m_coalesced.isEmpty()) {
         QByteArray result = reply->readAll();
 
-        _exec(m_slotsMap.value((onResponse_QByteArray)).second, QByteArray, result) {
-            emit finished(result);
-        }
+        deliver(m_handlers, result);
+        for (const auto &handlers : qAsConst(m_coalesced))
+            deliver(handlers, result);
 
         reply->deleteLater();
     }
-    else if (m_slotsMap.contains((onResponse_QVariantMap))) {
-        QByteArray result = reply->readAll();
-        QVariantMap resultMap = QJsonDocument::fromJson(result).object().toVariantMap();
-
-        _exec(m_slotsMap.value((onResponse_QVariantMap)).second, QVariantMap, resultMap) {
-            emit finished(resultMap);
-        }
+}
 
-        reply->deleteLater();
+void HttpResponse::deliver(const HttpResponseHandlers &handlers, const QByteArray &result)
+{
+    if (handlers.data) {
+        handlers.data(result);
+    }
+    else if (handlers.map) {
+        handlers.map(QJsonDocument::fromJson(result).object().toVariantMap());
     }
 }
 
@@ -195,143 +264,55 @@ void HttpResponse::onError(QNetworkReply::NetworkError error)
     QString errorString = reply->errorString().isEmpty() ? metaEnum.valueToKey(error) : reply->errorString();
     qDebug()<<Q_FUNC_INFO << " busy onError:" << errorString;
 
-    if (m_slotsMap.contains((onError_QString_QNetworkReply_A_Poniter))) {
-        _exec2(m_slotsMap.value((onError_QString_QNetworkReply_A_Poniter)).second, QString, QNetworkReply*, errorString, reply) {
-            emit this->error(errorString, reply);
-        }
-    }
-    else if (m_slotsMap.contains((onError_QNetworkReply_To_NetworkError_QNetworkReply_A_Pointer))) {
-        _exec2(m_slotsMap.value((onError_QNetworkReply_To_NetworkError_QNetworkReply_A_Pointer)).second,
-               QNetworkReply::NetworkError, QNetworkReply*,
-               error, reply) {
-            emit this->error(error, reply);
-        }
-    }
-    else if (m_slotsMap.contains((onError_QString))) {
-        _exec(m_slotsMap.value((onError_QString)).second, QString, errorString) {
-            emit this->error(errorString);
-        }
+    if (m_hedge && m_hedge != reply && m_hedge->isRunning()) {
+        // the copy is still on its way, it gets the last word
+        reply->disconnect(this);
         reply->deleteLater();
+        m_networkReply = m_hedge;
+        m_hedge = nullptr;
+        setParent(m_networkReply);
+        connectReply();
+        return;
     }
-    else if (m_slotsMap.contains((onError_QNetworkReply_To_NetworkError))) {
-        _exec(m_slotsMap.value((onError_QNetworkReply_To_NetworkError)).second, QNetworkReply::NetworkError, error) {
-            emit this->error(error);
-        }
 
-        reply->deleteLater();
+    if (m_retry && m_retry(reply)) {
+        // the reply of the retry takes over, see setNetworkReply()
+        reply->disconnect(this);
+        m_networkReply = nullptr;
+        return;
     }
-}
 
-void HttpResponse::onDownloadProgress(qint64 bytesReceived, qint64 bytesTotal)
-{
-    if (m_slotsMap.contains((onDownloadProgress_qint64_qint64))) {
-        _exec2(m_slotsMap.value((onDownloadProgress_qint64_qint64)).second, qint64, qint64, bytesReceived, bytesTotal) {
-            emit downloadProgress(bytesReceived, bytesTotal);
-        }
+    deliverError(m_handlers, error, errorString);
+    for (const auto &handlers : qAsConst(m_coalesced))
+        deliverError(handlers, error, errorString);
+
+    // the slots that were given the reply take care of it
+    if (!m_handlers.errorStringReply && !m_handlers.errorReply && (m_handlers.errorString || m_handlers.error)) {
+        reply->deleteLater();
     }
 }
 
-static void extractSlot(const QString &respReceiverSlot, QString &extractSlot, QStringList &extractSlotTypes)
+void HttpResponse::deliverError(const HttpResponseHandlers &handlers, QNetworkReply::NetworkError error, const QString &errorString)
 {
-    QString slot(respReceiverSlot);
-    if (extractCode(respReceiverSlot.toStdString().data()) == QSLOT_CODE && !slot.isEmpty()) {
-        slot.remove(0, 1);
-
-        QString unconvertedSlotType = slot;
-        int startIndex = slot.indexOf('(');
-        int endIndex = slot.indexOf(')');
-        Q_ASSERT(startIndex != -1 && endIndex != -1);
-
-        extractSlot = slot.remove(startIndex, endIndex-startIndex+1);
-
-        extractSlotTypes = unconvertedSlotType.mid(startIndex+1, endIndex-startIndex-1)
-                           .remove(QRegExp("\\s"))
-                           .split(',');
+    QNetworkReply *reply = m_networkReply;
+    if (handlers.errorStringReply) {
+        handlers.errorStringReply(errorString, reply);
     }
-}
-
-/* from slotMap get [SupportMethod] */
-static HttpResponse::SupportMethod getSupportMethod(const QPair<QString, QVariant> &slotMap) {
-
-    QMapIterator<HttpResponse::SupportMethod, QMap<QString, QVariant>> iter(methodParams);
-
-    QString receiverSlot = slotMap.first;
-    QString slot;
-    QStringList slotTypes;
-    extractSlot(receiverSlot, slot, slotTypes);
-
-    while (iter.hasNext()) {
-        iter.next();
-        HttpResponse::SupportMethod supportMethod = iter.key();
-        QMap<QString, QVariant> value = iter.value();
-        if (slotTypes == value.value("types").toStringList()) {
-            return supportMethod;
-        }
-        else if (receiverSlot == value.value("lambda").toString()) {
-            return supportMethod;
-        }
+    else if (handlers.errorReply) {
+        handlers.errorReply(error, reply);
     }
-
-    return HttpResponse::Invalid;
-}
-
-static void autoInfterConvertedSupportMethod(QMultiMap<HttpResponse::SupportMethod, QPair<QString, QVariant> > &unconvertedSlotsMap)
-{
-    QMultiMap<HttpResponse::SupportMethod, QPair<QString, QVariant> > convertedSlotsMap;
-    QMapIterator<HttpResponse::SupportMethod, QPair<QString, QVariant> > iter(unconvertedSlotsMap);
-
-    while (iter.hasNext()) {
-        iter.next();
-        const HttpResponse::SupportMethod supportMethod = iter.key();
-        const QPair<QString, QVariant> slotMap = iter.value();
-
-        if (supportMethod == HttpResponse::AutoInfer) {
-            HttpResponse::SupportMethod supportMethod  = getSupportMethod(slotMap);
-            if (supportMethod == HttpResponse::Invalid) {
-                qDebug()<<"Not find support Method!"<<slotMap.first;
-            }
-            else {
-                if (methodParams[supportMethod].value("isAutoInfer").toBool())
-                    convertedSlotsMap.insert(supportMethod, slotMap);
-                else
-                    qDebug()<<"This type["<<methodParams[supportMethod].value("types").toString()<<"] does not support automatic derivation";
-            }
-        }
-        else {
-            if (methodParams[supportMethod].value("isAutoInfer").toBool())
-                convertedSlotsMap.insert(supportMethod, slotMap);
-            else
-                qDebug()<<"This type["<<methodParams[supportMethod].value("types").toString()<<"] does not support automatic derivation";
-        }
+    else if (handlers.errorString) {
+        handlers.errorString(errorString);
+    }
+    else if (handlers.error) {
+        handlers.error(error);
     }
-
-    unconvertedSlotsMap = convertedSlotsMap;
-
 }
 
-void HttpResponse::slotsMapOperation(QMultiMap<SupportMethod, QPair<QString, QVariant> > &slotsMap)
+void HttpResponse::onDownloadProgress(qint64 bytesReceived, qint64 bytesTotal)
 {
-    autoInfterConvertedSupportMethod(slotsMap);
-
-    QMapIterator<SupportMethod, QPair<QString, QVariant> > iter(slotsMap);
-    while (iter.hasNext()) {
-        iter.next();
-        SupportMethod supportMethod = iter.key();
-        const QPair<QString, QVariant> &slotMap = iter.value();
-
-        const QString &receiverSlot = slotMap.first;
-        QVariant target = slotMap.second;
-        const QObject *receiver = target.value<QObject*>();
-
-        if (receiver) {
-            if (methodParams.contains(supportMethod)) {
-                connect(this,
-                        methodParams[supportMethod].value("signal").toString().toStdString().data(),
-                        receiver,
-                        receiverSlot.toStdString().data(),
-                        Qt::QueuedConnection);
-            }
-        }
+    if (m_handlers.downloadProgress) {
+        m_handlers.downloadProgress(bytesReceived, bytesTotal);
     }
 }
 
@@ -6,29 +6,80 @@
 #define HTTP_RESPONSE_H
 
 #include <QNetworkReply>
-#include <QMultiMap>
 #include <functional>
+#include <QPointer>
 #include <QTimer>
+#include <QVector>
 #include "discovercommon_export.h"
 
 //namespace AeaQt {
 
+/*
+ * Aborts a reply that made no progress for @timeout msec. Every received or
+ * sent chunk starts it over, a large download on a slow link is not cut off.
+ */
 class HttpResponseTimeout : public QObject {
     Q_OBJECT
 public:
     HttpResponseTimeout(QNetworkReply *parent = NULL, const int timeout = -1) : QObject(parent) {
-        if (timeout > 0)
-            QTimer::singleShot(timeout, this, SLOT(onTimeout()));
+        if (timeout <= 0)
+            return;
+        m_idle.setSingleShot(true);
+        m_idle.setInterval(timeout);
+        connect(&m_idle, SIGNAL(timeout()), this, SLOT(onTimeout()));
+        connect(parent, SIGNAL(metaDataChanged()), &m_idle, SLOT(start()));
+        connect(parent, SIGNAL(readyRead()), &m_idle, SLOT(start()));
+        connect(parent, SIGNAL(uploadProgress(qint64,qint64)), &m_idle, SLOT(start()));
+        m_idle.start();
     }
 
 private Q_SLOTS:
     void onTimeout() {
         QNetworkReply *reply = static_cast<QNetworkReply*>(parent());
         if (reply->isRunning()) {
+            // tells it apart from the other aborts, a timeout is worth retrying
+            reply->setProperty("timedOut", true);
             reply->abort();
             reply->deleteLater();
         }
     };
+
+private:
+    QTimer m_idle;
+};
+
+/*
+ * The slots of a request. Lambdas are sorted into their member by HttpRequest
+ * at compile time, QObject slots are connected to the matching HttpResponse
+ * signal once the request is sent.
+ * note: The same type is only triggered once, the last one set wins
+ */
+struct HttpResponseHandlers
+{
+    struct Receiver {
+        const QObject *receiver;
+        QByteArray slot;
+        int type; // HttpResponse::SupportMethod
+    };
+
+    void setResponse(std::function<void (QNetworkReply*)> &&lambda) { reply = std::move(lambda); }
+    void setResponse(std::function<void (QByteArray)> &&lambda) { data = std::move(lambda); }
+    void setResponse(std::function<void (QVariantMap)> &&lambda) { map = std::move(lambda); }
+    void setResponse(std::function<void (qint64, qint64)> &&lambda) { downloadProgress = std::move(lambda); }
+    void setError(std::function<void (QNetworkReply::NetworkError)> &&lambda) { error = std::move(lambda); }
+    void setError(std::function<void (QString)> &&lambda) { errorString = std::move(lambda); }
+    void setError(std::function<void (QNetworkReply::NetworkError, QNetworkReply*)> &&lambda) { errorReply = std::move(lambda); }
+    void setError(std::function<void (QString, QNetworkReply*)> &&lambda) { errorStringReply = std::move(lambda); }
+
+    std::function<void (QNetworkReply*)> reply;
+    std::function<void (QByteArray)> data;
+    std::function<void (QVariantMap)> map;
+    std::function<void (qint64, qint64)> downloadProgress;
+    std::function<void (QNetworkReply::NetworkError)> error;
+    std::function<void (QString)> errorString;
+    std::function<void (QNetworkReply::NetworkError, QNetworkReply*)> errorReply;
+    std::function<void (QString, QNetworkReply*)> errorStringReply;
+    QVector<Receiver> receivers;
 };
 
 class DISCOVERCOMMON_EXPORT HttpResponse : public QObject
@@ -38,7 +89,7 @@ public:
     /*
      * Support Reflex Method
      * default: AutoInfer
-     * AutoInfer: Automatic derivation based on type
+     * AutoInfer: Automatic derivation based on the slot signature
      */
     enum SupportMethod {
         Invalid = 0,
@@ -54,16 +105,44 @@ public:
     };
 
     explicit HttpResponse(QNetworkReply *networkReply,
-                          const QMultiMap<SupportMethod, QPair<QString, QVariant> > &slotsMap,
+                          const HttpResponseHandlers &handlers,
+                          const int &timeout,
+                          bool isBlock);
+    /* A response whose request waits in HttpClient's queue, see setNetworkReply() */
+    explicit HttpResponse(QObject *parent,
+                          const HttpResponseHandlers &handlers,
                           const int &timeout,
                           bool isBlock);
 
     virtual ~HttpResponse();
 
+    /* nullptr while the request is queued */
     QNetworkReply *networkReply();
+    /*
+     * The request was sent, the response now belongs to @networkReply.
+     * It is aborted once nothing arrived for @timeout msec, a minute when @timeout <= 0.
+     * Called again with the reply of each retry.
+     */
+    void setNetworkReply(QNetworkReply *networkReply, int timeout);
+    /* Asked before an error is delivered, returns true when the request is sent again */
+    void setRetryHandler(std::function<bool (QNetworkReply*)> &&retry);
+    /*
+     * A copy of the request, whichever of both replies succeeds first is delivered.
+     * A reply that fails or times out while the other one is still running yields to it.
+     * @timeout as for setNetworkReply()
+     */
+    void hedge(QNetworkReply *hedge, int timeout);
+
+    /*
+     * Delivers the result to the slots of an identical request as well.
+     * note: they must not take the QNetworkReply, it is read only once
+     */
+    void attach(const HttpResponseHandlers &handlers);
 
 protected:
-    void slotsMapOperation(QMultiMap<SupportMethod, QPair<QString, QVariant> > &slotsMap);
+    void connectReceivers(HttpResponseHandlers &handlers);
+    void deliver(const HttpResponseHandlers &handlers, const QByteArray &result);
+    void deliverError(const HttpResponseHandlers &handlers, QNetworkReply::NetworkError error, const QString &errorString);
 
 Q_SIGNALS:
     void finished(QNetworkReply *reply);
@@ -82,23 +161,20 @@ private Q_SLOTS:
 
 private:
     HttpResponse();
+    static bool isCacheOnly(QNetworkReply *reply);
+    void connectReply();
 
 private:
-    QMultiMap<SupportMethod, QPair<QString, QVariant> > m_slotsMap;
-    QNetworkReply *m_networkReply;
+    HttpResponseHandlers m_handlers;
+    QVector<HttpResponseHandlers> m_coalesced;
+    std::function<bool (QNetworkReply*)> m_retry;
+    QNetworkReply *m_networkReply = nullptr;
+    /* the copy sent by hedge(), while it is still running */
+    QPointer<QNetworkReply> m_hedge;
+    int m_timeout = -1;
+    bool m_isBlock = false;
 };
 
 //}
 
-Q_DECLARE_METATYPE(std::function<void (QNetworkReply*)>)
-Q_DECLARE_METATYPE(std::function<void (QByteArray)>)
-Q_DECLARE_METATYPE(std::function<void (QVariantMap)>)
-
-Q_DECLARE_METATYPE(std::function<void (QString)>)
-Q_DECLARE_METATYPE(std::function<void (QNetworkReply::NetworkError)>)
-Q_DECLARE_METATYPE(std::function<void (QNetworkReply::NetworkError, QNetworkReply *)>)
-Q_DECLARE_METATYPE(std::function<void (QString, QNetworkReply *)>)
-
-Q_DECLARE_METATYPE(std::function<void (qint64, qint64)>)
-
 #endif // HTTP_RESPONSE_H
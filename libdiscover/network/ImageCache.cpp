@@ -0,0 +1,229 @@
+/*
+ *   SPDX-FileCopyrightText:      2021 Wang Rui <wangrui@jingos.com>
+ *   SPDX-License-Identifier:     LGPL-2.1-only OR LGPL-3.0-only OR LicenseRef-KDE-Accepted-LGPL
+ */
+#include "ImageCache.h"
+#include "HttpCache.h"
+#include "HttpClient.h"
+
+#include <QBuffer>
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QFutureWatcher>
+#include <QImageReader>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QtConcurrent>
+
+#define CACHE_DIRECTORY "/thumbnails"
+#define DISK_CACHE_SIZE (100 * 1024 * 1024)
+#define THUMBNAIL_MAGIC 0x31485444 // "DTH1"
+#define THUMBNAIL_MAX_SIDE 4096
+// written thumbnails between two trims
+#define TRIM_INTERVAL 32
+
+// @size bounds the width and the height, a side of 0 is not bounded
+static QSize fitting(const QSize &original, const QSize &size)
+{
+    const QSize bound(size.width() > 0 ? size.width() : original.width(),
+                      size.height() > 0 ? size.height() : original.height());
+    if (original.width() <= bound.width() && original.height() <= bound.height())
+        return original;
+    return original.scaled(bound, Qt::KeepAspectRatio);
+}
+
+ImageCache::ImageCache(const QString &directory, QObject *parent)
+    : QObject(parent)
+    , m_directory(directory)
+    , m_maximumSize(DISK_CACHE_SIZE)
+{
+    QDir().mkpath(m_directory);
+    scheduleTrim();
+}
+
+ImageCache::~ImageCache() = default;
+
+ImageCache *ImageCache::global()
+{
+    static ImageCache *s_self = nullptr;
+    if (!s_self)
+        s_self = new ImageCache(QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + QLatin1String(CACHE_DIRECTORY), HttpClient::global());
+    return s_self;
+}
+
+QString ImageCache::thumbnailPath(const QUrl &url, const QSize &size) const
+{
+    // QML asks for negative sizes when the Image has no sourceSize
+    const QByteArray key = url.toEncoded() + '@' + QByteArray::number(qMax(0, size.width())) + 'x' + QByteArray::number(qMax(0, size.height()));
+    return m_directory + QLatin1Char('/') + QString::fromLatin1(QCryptographicHash::hash(key, QCryptographicHash::Sha1).toHex());
+}
+
+qint64 ImageCache::maximumSize() const
+{
+    return m_maximumSize;
+}
+
+void ImageCache::setMaximumSize(qint64 size)
+{
+    m_maximumSize = size;
+    scheduleTrim();
+}
+
+QVariantMap ImageCache::stats() const
+{
+    QVariantMap stats = static_cast<HttpCache *>(HttpClient::global()->cache())->stats();
+    stats.insert(QStringLiteral("thumbnailHits"), m_thumbnailHits);
+    stats.insert(QStringLiteral("thumbnailMisses"), m_thumbnailMisses);
+    return stats;
+}
+
+void ImageCache::load(const QUrl &url, const QSize &size, QObject *context, Handler &&done, HttpRequest::Priority priority)
+{
+    const QString path = thumbnailPath(url, size);
+    const bool loading = m_waiting.contains(path);
+    m_waiting[path] += Waiting{context, std::move(done)};
+    if (loading)
+        return;
+
+    auto watcher = new QFutureWatcher<QImage>(this);
+    connect(watcher, &QFutureWatcherBase::finished, this, [this, watcher, url, size, path, priority] {
+        const QImage image = watcher->result();
+        watcher->deleteLater();
+        if (image.isNull()) {
+            ++m_thumbnailMisses;
+            fetch(url, size, path, priority);
+        } else {
+            ++m_thumbnailHits;
+            finished(path, image);
+        }
+    });
+    watcher->setFuture(QtConcurrent::run(HttpClient::global()->decoderPool(), &ImageCache::readThumbnail, path));
+}
+
+void ImageCache::prefetchOriginals(const QList<QUrl> &urls)
+{
+    for (const QUrl &url : urls) {
+        if (!url.isValid() || m_originals.contains(url))
+            continue;
+        m_originals.insert(url);
+        HttpClient::global()->get(url.toString())
+            .removePublicQueryParams()
+            .cachePolicy(HttpRequest::CacheFirst)
+            .priority(HttpRequest::Prefetch)
+            .onResponse([](QByteArray) {})
+            .onError([this, url](QString) { m_originals.remove(url); })
+            .exec();
+    }
+}
+
+void ImageCache::fetch(const QUrl &url, const QSize &size, const QString &path, HttpRequest::Priority priority)
+{
+    // the same image shown at another size is decoded again, not downloaded again
+    HttpClient::global()->get(url.toString())
+        .removePublicQueryParams()
+        .cachePolicy(HttpRequest::CacheFirst)
+        .priority(priority)
+        .onDecoded(this, [size, path](const QByteArray &data) {
+            const QImage image = decode(data, size);
+            if (!image.isNull())
+                writeThumbnail(path, image);
+            return image;
+        }, [this, path](const QImage &image) {
+            if (!image.isNull() && ++m_written % TRIM_INTERVAL == 0)
+                scheduleTrim();
+            finished(path, image);
+        })
+        .onError([this, path](QString) {
+            finished(path, QImage());
+        })
+        .exec();
+}
+
+void ImageCache::finished(const QString &path, const QImage &image)
+{
+    const QVector<Waiting> waiting = m_waiting.take(path);
+    for (const Waiting &w : waiting) {
+        if (w.context && w.done)
+            w.done(image);
+    }
+}
+
+QImage ImageCache::decode(const QByteArray &data, const QSize &size)
+{
+    QBuffer buffer;
+    buffer.setData(data);
+    buffer.open(QIODevice::ReadOnly);
+    QImageReader reader(&buffer);
+    // formats that can (jpeg) are decoded straight at the smaller size
+    const QSize original = reader.size();
+    if (original.isValid())
+        reader.setScaledSize(fitting(original, size));
+
+    QImage image = reader.read();
+    if (image.isNull())
+        return image;
+    const QSize scaled = fitting(image.size(), size);
+    if (scaled != image.size())
+        image = image.scaled(scaled, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+    // what the scene graph uploads, the GUI thread does not have to convert it
+    return image.convertToFormat(QImage::Format_ARGB32_Premultiplied);
+}
+
+QImage ImageCache::readThumbnail(const QString &path)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly))
+        return QImage();
+
+    quint32 header[3];
+    if (file.read(reinterpret_cast<char *>(header), sizeof(header)) != sizeof(header)
+        || header[0] != THUMBNAIL_MAGIC || header[1] > THUMBNAIL_MAX_SIDE || header[2] > THUMBNAIL_MAX_SIDE)
+        return QImage();
+
+    QImage image(int(header[1]), int(header[2]), QImage::Format_ARGB32_Premultiplied);
+    if (image.isNull() || file.read(reinterpret_cast<char *>(image.bits()), image.sizeInBytes()) != image.sizeInBytes())
+        return QImage();
+    // trim() removes the thumbnails that were not shown for the longest time first
+    file.setFileTime(QDateTime::currentDateTime(), QFileDevice::FileModificationTime);
+    return image;
+}
+
+bool ImageCache::writeThumbnail(const QString &path, const QImage &image)
+{
+    if (image.width() > THUMBNAIL_MAX_SIDE || image.height() > THUMBNAIL_MAX_SIDE)
+        return false;
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly))
+        return false;
+    // 32 bit pixels, the lines are never padded
+    const quint32 header[3] = { THUMBNAIL_MAGIC, quint32(image.width()), quint32(image.height()) };
+    file.write(reinterpret_cast<const char *>(header), sizeof(header));
+    file.write(reinterpret_cast<const char *>(image.constBits()), image.sizeInBytes());
+    return file.commit();
+}
+
+void ImageCache::scheduleTrim()
+{
+    QtConcurrent::run(HttpClient::global()->decoderPool(), &ImageCache::trim, m_directory, m_maximumSize);
+}
+
+void ImageCache::trim(const QString &directory, qint64 maximumSize)
+{
+    const QFileInfoList files = QDir(directory).entryInfoList(QDir::Files, QDir::Time);
+    qint64 total = 0;
+    for (const QFileInfo &file : files)
+        total += file.size();
+    if (total <= maximumSize)
+        return;
+
+    // down to 90% so that the next thumbnails do not trim again right away
+    qint64 kept = 0;
+    for (const QFileInfo &file : files) {
+        kept += file.size();
+        if (kept > maximumSize * 9 / 10)
+            QFile::remove(file.absoluteFilePath());
+    }
+}
@@ -0,0 +1,90 @@
+/*
+ *   SPDX-FileCopyrightText:      2021 Wang Rui <wangrui@jingos.com>
+ *   SPDX-License-Identifier:     LGPL-2.1-only OR LGPL-3.0-only OR LicenseRef-KDE-Accepted-LGPL
+ */
+#ifndef IMAGE_CACHE_H
+#define IMAGE_CACHE_H
+
+#include <QObject>
+#include <QHash>
+#include <QImage>
+#include <QPointer>
+#include <QSet>
+#include <QUrl>
+#include <QVariantMap>
+#include <functional>
+#include "network/HttpRequest.h"
+#include "discovercommon_export.h"
+
+/**
+ * Remote icons and banners, decoded and scaled down to the size they are shown at.
+ *
+ * Downloads go through HttpClient, decoding and scaling happen on its decoder
+ * pool. The result is kept on disk as raw premultiplied pixels, so showing it
+ * again is a file read: nothing is downloaded nor decoded. The thumbnails that
+ * were not used for the longest time are removed once the directory grows
+ * beyond maximumSize().
+ */
+class DISCOVERCOMMON_EXPORT ImageCache : public QObject
+{
+    Q_OBJECT
+public:
+    typedef std::function<void(const QImage &image)> Handler;
+
+    explicit ImageCache(const QString &directory, QObject *parent = nullptr);
+    ~ImageCache() override;
+    /* Has to be created in the GUI thread */
+    static ImageCache *global();
+
+    /*
+     * @load: Calls @done with @url scaled down to fit @size (not scaled when
+     *        @size is empty), or with a null image when it could not be loaded.
+     *        @done is called in the thread of the cache unless @context is gone.
+     *        Loads of the same thumbnail share one download.
+     */
+    void load(const QUrl &url, const QSize &size, QObject *context, Handler &&done,
+              HttpRequest::Priority priority = HttpRequest::Interactive);
+    /*
+     * Downloads @urls into HttpClient's cache without decoding them, for
+     * images whose size is not known yet. Any size is then decoded without
+     * downloading again.
+     */
+    void prefetchOriginals(const QList<QUrl> &urls);
+
+    QString thumbnailPath(const QUrl &url, const QSize &size) const;
+
+    qint64 maximumSize() const;
+    void setMaximumSize(qint64 size);
+
+    /*
+     * thumbnailHits and thumbnailMisses of load(), with the hits, misses and
+     * bytesSaved of HttpClient's cache, where the originals come from
+     */
+    QVariantMap stats() const;
+
+private:
+    struct Waiting {
+        QPointer<QObject> context;
+        Handler done;
+    };
+
+    static QImage decode(const QByteArray &data, const QSize &size);
+    static QImage readThumbnail(const QString &path);
+    static bool writeThumbnail(const QString &path, const QImage &image);
+    static void trim(const QString &directory, qint64 maximumSize);
+
+    void fetch(const QUrl &url, const QSize &size, const QString &path, HttpRequest::Priority priority);
+    void finished(const QString &path, const QImage &image);
+    void scheduleTrim();
+
+    const QString m_directory;
+    qint64 m_maximumSize;
+    int m_written = 0;
+    qint64 m_thumbnailHits = 0;
+    qint64 m_thumbnailMisses = 0;
+    QSet<QUrl> m_originals;
+    // by thumbnail path
+    QHash<QString, QVector<Waiting>> m_waiting;
+};
+
+#endif // IMAGE_CACHE_H
@@ -3,11 +3,36 @@
  *   SPDX-License-Identifier:     LGPL-2.1-only OR LGPL-3.0-only OR LicenseRef-KDE-Accepted-LGPL
  */
 #include "networkutils.h"
+#include "Transaction/TransactionModel.h"
+
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QSaveFile>
+#include <QStandardPaths>
 
 #define REPORT_URL "actionReport"
+#define REPORT_QUEUE_FILE "/reports.json"
+// reports of one session are flushed together, one after another on the kept-alive connection
+#define FLUSH_INTERVAL (30 * 1000)
+#define MAX_RETRY_INTERVAL (60 * 60 * 1000)
+#define MAX_QUEUE_SIZE 1000
+
 NetworkUtils::NetworkUtils()
 {
+    m_flushTimer.setSingleShot(true);
+    connect(&m_flushTimer, &QTimer::timeout, this, &NetworkUtils::flush);
+    // transactions keep the queue waiting, the last one to finish sends it
+    connect(TransactionModel::global(), &TransactionModel::lastTransactionFinished, this, [this] {
+        if (!m_pending.isEmpty() && !m_flushTimer.isActive())
+            scheduleFlush(0);
+    });
 
+    loadQueue();
+    if (!m_pending.isEmpty())
+        scheduleFlush(FLUSH_INTERVAL);
 }
 
 NetworkUtils *NetworkUtils::s_self = nullptr;
@@ -44,17 +69,115 @@ void NetworkUtils::appStatusReport(Status status, AbstractResource *resource)
     reportDataJson["resultMessage"] = "Message";
     reportDataJson["architecture"] = "x86";
 
+    if (m_pending.size() >= MAX_QUEUE_SIZE) {
+        m_pending.removeFirst();
+    }
+    m_pending.append(reportDataJson);
+    saveQueue();
+    if (!m_flushTimer.isActive()) {
+        scheduleFlush(FLUSH_INTERVAL);
+    }
+}
+
+void NetworkUtils::flush()
+{
+    if (m_sending || m_pending.isEmpty()) {
+        return;
+    }
+    if (TransactionModel::global()->rowCount() > 0) {
+        // lastTransactionFinished gets it going again
+        return;
+    }
+
+    // actionReport takes a single report object per POST, the queue is drained one at a time
+    m_sending = true;
+    const QByteArray body = QJsonDocument(m_pending.first().toObject()).toJson(QJsonDocument::Compact);
+
     HttpClient::global() -> post(QLatin1String(BASE_URL) + QLatin1String(REPORT_URL))
     .header("content-type", "application/json")
-    .body(reportDataJson)
+    .body(body)
     .onResponse([this](QByteArray result) {
+        Q_UNUSED(result);
+        reportsSent();
     })
-    .onError([this](QString errorStr) {
-        return;
+    .onError([this](QNetworkReply::NetworkError error, QNetworkReply *reply) {
+        Q_UNUSED(error);
+        const int status = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+        reply->deleteLater();
+        if (isRejected(status)) {
+            // sending it again would not change the answer, it must not hold back the others
+            qWarning() << "actionReport rejected a report:" << status << m_pending.first().toObject();
+            reportsSent();
+            return;
+        }
+        reportsFailed();
     })
     .timeout(10 * 1000)
+    .priority(HttpRequest::Background)
     .removePublicQueryParams()
     .exec();
 }
 
+QString NetworkUtils::queuePath()
+{
+    return QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) + QLatin1String(REPORT_QUEUE_FILE);
+}
+
+void NetworkUtils::loadQueue()
+{
+    QFile file(queuePath());
+    if (!file.open(QIODevice::ReadOnly)) {
+        return;
+    }
+    m_pending = QJsonDocument::fromJson(file.readAll()).array();
+}
 
+void NetworkUtils::saveQueue()
+{
+    const QString path = queuePath();
+    if (m_pending.isEmpty()) {
+        QFile::remove(path);
+        return;
+    }
+    QDir().mkpath(QFileInfo(path).absolutePath());
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        return;
+    }
+    file.write(QJsonDocument(m_pending).toJson(QJsonDocument::Compact));
+    file.commit();
+}
+
+void NetworkUtils::scheduleFlush(int msec)
+{
+    m_flushTimer.start(msec);
+}
+
+void NetworkUtils::reportsSent()
+{
+    // the report that was in flight, always the first one
+    if (!m_pending.isEmpty()) {
+        m_pending.removeFirst();
+    }
+    m_sending = false;
+    m_failures = 0;
+    saveQueue();
+    if (!m_pending.isEmpty()) {
+        scheduleFlush(0);
+    }
+}
+
+bool NetworkUtils::isRejected(int status)
+{
+    // timeouts, connection errors (no status), 5xx, 408 and 429 are worth another try
+    return status >= 400 && status < 500 && status != 408 && status != 429;
+}
+
+void NetworkUtils::reportsFailed()
+{
+    m_sending = false;
+    ++m_failures;
+    // 1, 2, 4... minutes up to an hour, the queue stays on disk meanwhile
+    const int shift = qMin(m_failures - 1, 6);
+    scheduleFlush(qMin(FLUSH_INTERVAL * 2 * (1 << shift), MAX_RETRY_INTERVAL));
+}
@@ -6,6 +6,8 @@
 #define NETWORKUTILS_H
 
 #include <QObject>
+#include <QJsonArray>
+#include <QTimer>
 #include <resources/AbstractResource.h>
 #include "network/HttpClient.h"
 #include "discovercommon_export.h"
@@ -22,8 +24,29 @@ public:
     };
     static NetworkUtils* global();
     static NetworkUtils* s_self;
+    /*
+     * Queues the report, the queue is sent once no transaction is running,
+     * one report per POST. It is kept on disk until the server accepted or
+     * rejected (4xx) each report, the other errors are retried later.
+     */
     void appStatusReport(Status status, AbstractResource *resource);
+    /* Sends what is queued unless a transaction is running */
+    void flush();
 
+private:
+    static QString queuePath();
+    /* An HTTP @status the report will never be accepted with */
+    static bool isRejected(int status);
+    void loadQueue();
+    void saveQueue();
+    void scheduleFlush(int msec);
+    void reportsSent();
+    void reportsFailed();
+
+    QJsonArray m_pending;
+    QTimer m_flushTimer;
+    bool m_sending = false;
+    int m_failures = 0;
 };
 
 #endif // NETWORKUTILS_H
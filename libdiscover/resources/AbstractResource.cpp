@@ -74,25 +74,29 @@ QString AbstractResource::screenShots()
 
 void AbstractResource::setScreenShots(QString shotsJson)
 {
-    m_screenShotsJson = shotsJson;
+    // set again every time the details page opens
+    if (shotsJson != m_screenShotsJson) {
+        m_screenShotsJson = shotsJson;
+        m_thumbnails.clear();
+        m_screenshots.clear();
+        const QJsonArray shotArray = QJsonDocument::fromJson(shotsJson.toUtf8()).array();
+        for (const QJsonValue &shot : shotArray) {
+            const QJsonObject shotObj = shot.toObject();
+            const QUrl url(shotObj.value(QLatin1String("url")).toString());
+            // the server only sends a smaller version for some of them
+            QString thumbnail = shotObj.value(QLatin1String("thumbnail")).toString();
+            if (thumbnail.isEmpty())
+                thumbnail = shotObj.value(QLatin1String("thumbnailUrl")).toString();
+            m_screenshots.append(url);
+            m_thumbnails.append(thumbnail.isEmpty() ? url : QUrl(thumbnail));
+        }
+    }
     fetchScreenshots();
 }
 
 void AbstractResource::fetchScreenshots()
 {
-    QList<QUrl> thumbnails;
-    QList<QUrl> screenshots;
-    auto shotsJson = screenShots();
-    auto shotArray = QJsonDocument::fromJson(shotsJson.toUtf8()).array();
-    for (int i = 0; i < shotArray.size(); i++) {
-        auto shotObj = shotArray.at(i).toObject();
-        auto shotUrl = shotObj.value("url").toString();
-        auto shotType = shotObj.value("type").toString();
-        QUrl url(shotUrl);
-        screenshots.append(url);
-        thumbnails.append(url);
-    }
-    emit screenshotsFetched(thumbnails, screenshots);
+    emit screenshotsFetched(m_thumbnails, m_screenshots);
 }
 
 QStringList AbstractResource::mimetypes() const
@@ -164,30 +168,73 @@ void AbstractResource::reportNewState()
     emit backend()->resourcesChanged(this, ns);
 }
 
-static bool shouldFilter(AbstractResource* res, const QPair<FilterType, QString>& filter)
+// What the category filters look at, read once for all the categories walked
+class AbstractResource::CategoryKeys
+{
+public:
+    explicit CategoryKeys(AbstractResource* res)
+        : m_res(res)
+    {}
+
+    const QStringList& categories() {
+        if (!(m_read & Categories)) {
+            m_categories = m_res->categories();
+            m_read |= Categories;
+        }
+        return m_categories;
+    }
+    const QString& section() {
+        if (!(m_read & Section)) {
+            m_section = m_res->section();
+            m_read |= Section;
+        }
+        return m_section;
+    }
+    const QString& packageName() {
+        if (!(m_read & PackageName)) {
+            m_packageName = m_res->packageName();
+            m_read |= PackageName;
+        }
+        return m_packageName;
+    }
+    const QString& appstreamId() {
+        if (!(m_read & AppstreamId)) {
+            m_appstreamId = m_res->appstreamId();
+            m_read |= AppstreamId;
+        }
+        return m_appstreamId;
+    }
+
+private:
+    enum Key { Categories = 1, Section = 2, PackageName = 4, AppstreamId = 8 };
+    AbstractResource* const m_res;
+    int m_read = 0;
+    QStringList m_categories;
+    QString m_section;
+    QString m_packageName;
+    QString m_appstreamId;
+};
+
+// templates because CategoryKeys is private
+template <typename Keys>
+static bool shouldFilter(Keys& keys, const Category::Predicate& filter)
 {
     bool ret = true;
-    switch (filter.first) {
+    switch (filter.type) {
     case CategoryFilter:
-        ret = res->categories().contains(filter.second);
+        ret = keys.categories().contains(filter.token);
         break;
     case PkgSectionFilter:
-        ret = res->section() == filter.second;
+        ret = keys.section() == filter.token;
+        break;
+    case PkgWildcardFilter:
+        ret = filter.matcher.indexIn(keys.packageName()) >= 0;
+        break;
+    case AppstreamIdWildcardFilter:
+        ret = filter.matcher.indexIn(keys.appstreamId()) >= 0;
         break;
-    case PkgWildcardFilter: {
-        QString wildcard = filter.second;
-        wildcard.remove(QLatin1Char('*'));
-        ret = res->packageName().contains(wildcard);
-    }
-    break;
-    case AppstreamIdWildcardFilter: {
-        QString wildcard = filter.second;
-        wildcard.remove(QLatin1Char('*'));
-        ret = res->appstreamId().contains(wildcard);
-    }
-    break;
     case PkgNameFilter: // Only useful in the not filters
-        ret = res->packageName() == filter.second;
+        ret = keys.packageName() == filter.token;
         break;
     case InvalidFilter:
         break;
@@ -195,13 +242,13 @@ static bool shouldFilter(AbstractResource* res, const QPair<FilterType, QString>
     return ret;
 }
 
-bool AbstractResource::categoryMatches(Category* cat)
+template <typename Keys>
+static bool evaluate(Keys& keys, const Category::Predicates& predicates)
 {
     {
-        const auto orFilters = cat->orFilters();
-        bool orValue = orFilters.isEmpty();
-        for (const auto& filter: orFilters) {
-            if (shouldFilter(this, filter)) {
+        bool orValue = predicates.orFilters.isEmpty();
+        for (const auto& filter : predicates.orFilters) {
+            if (shouldFilter(keys, filter)) {
                 orValue = true;
                 break;
             }
@@ -210,18 +257,50 @@ bool AbstractResource::categoryMatches(Category* cat)
             return false;
     }
 
-    Q_FOREACH (const auto &filter, cat->andFilters()) {
-        if (!shouldFilter(this, filter))
+    for (const auto& filter : predicates.andFilters) {
+        if (!shouldFilter(keys, filter))
             return false;
     }
 
-    Q_FOREACH (const auto &filter, cat->notFilters()) {
-        if (shouldFilter(this, filter))
+    for (const auto& filter : predicates.notFilters) {
+        if (shouldFilter(keys, filter))
             return false;
     }
     return true;
 }
 
+bool AbstractResource::categoryMatches(Category* cat)
+{
+    CategoryKeys keys(this);
+    return categoryMatches(cat, keys);
+}
+
+bool AbstractResource::categoryMatches(Category* cat, CategoryKeys& keys)
+{
+    const int generation = Category::filtersGeneration();
+    if (m_categoryGeneration != generation) {
+        m_categoryKnown.clear();
+        m_categoryMatches.clear();
+        m_categoryGeneration = generation;
+    }
+
+    const int bit = cat->index();
+    if (bit >= m_categoryKnown.size()) {
+        m_categoryKnown.resize(bit + 1);
+        m_categoryMatches.resize(bit + 1);
+    }
+    if (!m_categoryKnown.testBit(bit)) {
+        m_categoryMatches.setBit(bit, evaluate(keys, cat->predicates()));
+        m_categoryKnown.setBit(bit);
+    }
+    return m_categoryMatches.testBit(bit);
+}
+
+void AbstractResource::invalidateCategoryMatches()
+{
+    m_categoryGeneration = -1;
+}
+
 static QSet<Category*> walkCategories(AbstractResource* res, const QVector<Category*>& cats)
 {
     QSet<Category*> ret;
@@ -244,6 +323,28 @@ QSet<Category*> AbstractResource::categoryObjects(const QVector<Category*>& cats
     return walkCategories(const_cast<AbstractResource*>(this), cats);
 }
 
+void AbstractResource::addCategoryLeaves(const QVector<Category*>& cats, QBitArray& leaves)
+{
+    CategoryKeys keys(this);
+    addCategoryLeaves(cats, leaves, keys);
+}
+
+bool AbstractResource::addCategoryLeaves(const QVector<Category*>& cats, QBitArray& leaves, CategoryKeys& keys)
+{
+    bool found = false;
+    for (Category* cat : cats) {
+        if (!categoryMatches(cat, keys))
+            continue;
+        found = true;
+        if (!addCategoryLeaves(cat->subCategories(), leaves, keys)) {
+            if (cat->index() >= leaves.size())
+                leaves.resize(cat->index() + 1);
+            leaves.setBit(cat->index());
+        }
+    }
+    return found;
+}
+
 QString AbstractResource::categoryDisplay() const
 {
     // const auto matchedCategories = categoryObjects(CategoryModel::global()->rootCategories());
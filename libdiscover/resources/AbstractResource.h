@@ -17,6 +17,7 @@
 #include <QJsonArray>
 #include <QDate>
 #include <QSet>
+#include <QBitArray>
 
 #include "discovercommon_export.h"
 #include "PackageState.h"
@@ -256,6 +257,16 @@ public:
     bool categoryMatches(Category* cat);
 
     QSet<Category*> categoryObjects(const QVector<Category*>& cats) const;
+    /**
+     * Sets in @p leaves the bits (Category::index()) of what categoryObjects()
+     * returns, so the categories of many resources are a bitwise or.
+     */
+    void addCategoryLeaves(const QVector<Category*>& cats, QBitArray& leaves);
+    /**
+     * Forgets which categories matched, for when the categories, section,
+     * package name or AppStream id of the resource changed
+     */
+    void invalidateCategoryMatches();
 
     /**
      * @returns a url that uniquely identifies the application
@@ -296,7 +307,10 @@ Q_SIGNALS:
     void changelogFetched(const QString& changelog);
 
 private:
+    class CategoryKeys;
     void reportNewState();
+    bool categoryMatches(Category* cat, CategoryKeys& keys);
+    bool addCategoryLeaves(const QVector<Category*>& cats, QBitArray& leaves, CategoryKeys& keys);
 
 //         TODO: make it std::optional or make QCollatorSortKey()
     QScopedPointer<QCollatorSortKey> m_collatorKey;
@@ -305,6 +319,13 @@ private:
     QString m_banner;
     QString m_categoryDisplay;
     QString m_screenShotsJson;
+    // m_screenShotsJson parsed, the thumbnails fall back to the screenshots
+    QList<QUrl> m_thumbnails;
+    QList<QUrl> m_screenshots;
+    // bit Category::index() of m_categoryMatches is only valid when set in m_categoryKnown
+    QBitArray m_categoryKnown;
+    QBitArray m_categoryMatches;
+    int m_categoryGeneration = -1;
 };
 
 Q_DECLARE_METATYPE(QVector<AbstractResource*>)
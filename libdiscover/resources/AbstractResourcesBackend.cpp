@@ -56,6 +56,22 @@ void ResultsStream::finish()
     deleteLater();
 }
 
+void ResultsStream::markStale()
+{
+    if (m_stale)
+        return;
+    m_stale = true;
+    Q_EMIT stale();
+}
+
+void ResultsStream::setWaitingForMore(bool waiting)
+{
+    if (m_waitingForMore == waiting)
+        return;
+    m_waitingForMore = waiting;
+    Q_EMIT waitingForMoreChanged(waiting);
+}
+
 AbstractResourcesBackend::AbstractResourcesBackend(QObject* parent)
     : QObject(parent)
 {
@@ -33,9 +33,28 @@ public:
 
     void finish();
 
+    /// the results come from local data that may be outdated, @see stale
+    void markStale();
+    bool isStale() const {
+        return m_stale;
+    }
+
+    /// there are more results, the stream only looks for them once fetchMore() is emitted
+    void setWaitingForMore(bool waiting);
+    bool isWaitingForMore() const {
+        return m_waitingForMore;
+    }
+
 Q_SIGNALS:
     void resourcesFound(const QVector<AbstractResource*>& resources);
     void fetchMore();
+    /// emitted once, the results are worth asking for again when back online
+    void stale();
+    void waitingForMoreChanged(bool waiting);
+
+private:
+    bool m_stale = false;
+    bool m_waitingForMore = false;
 };
 
 /**
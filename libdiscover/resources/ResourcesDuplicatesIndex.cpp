@@ -0,0 +1,98 @@
+/*
+ *   SPDX-FileCopyrightText: 2021 Wang Rui <wangrui@jingos.com>
+ *   SPDX-License-Identifier: GPL-2.0-only OR GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+ */
+
+#include "ResourcesDuplicatesIndex.h"
+#include "AbstractResource.h"
+
+ResourcesDuplicatesIndex::Ids ResourcesDuplicatesIndex::idsFor(AbstractResource* res)
+{
+    return { res->appstreamId(), res->alternativeAppstreamIds() };
+}
+
+AbstractResource* ResourcesDuplicatesIndex::findId(const QString& id) const
+{
+    auto it = m_byId.constFind(id);
+    if (it != m_byId.constEnd())
+        return *it;
+
+    const auto aliased = m_aliases.constFind(id);
+    if (aliased != m_aliases.constEnd()) {
+        it = m_byId.constFind(*aliased);
+        if (it != m_byId.constEnd())
+            return *it;
+    }
+    return nullptr;
+}
+
+AbstractResource* ResourcesDuplicatesIndex::findOrInsert(AbstractResource* res)
+{
+    const auto indexed = m_resources.constFind(res);
+    if (indexed != m_resources.constEnd())
+        return indexed->appstreamId.isEmpty() ? nullptr : res;
+
+    const Ids ids = idsFor(res);
+    if (ids.appstreamId.isEmpty())
+        return nullptr;
+
+    if (auto found = findId(ids.appstreamId))
+        return found;
+    for (const auto &alt : ids.alternatives) {
+        if (auto found = findId(alt))
+            return found;
+    }
+
+    insert(res, ids);
+    return nullptr;
+}
+
+void ResourcesDuplicatesIndex::insert(AbstractResource* res)
+{
+    if (!m_resources.contains(res))
+        insert(res, idsFor(res));
+}
+
+void ResourcesDuplicatesIndex::insert(AbstractResource* res, const Ids& ids)
+{
+    if (ids.appstreamId.isEmpty())
+        return;
+
+    m_resources.insert(res, ids);
+    // the first one to show up keeps the id when duplicates are allowed
+    if (!m_byId.contains(ids.appstreamId))
+        m_byId.insert(ids.appstreamId, res);
+    for (const auto &alias : ids.alternatives)
+        m_aliases.insert(alias, ids.appstreamId);
+}
+
+void ResourcesDuplicatesIndex::remove(AbstractResource* res)
+{
+    const auto it = m_resources.find(res);
+    if (it == m_resources.end())
+        return;
+
+    const Ids ids = *it;
+    m_resources.erase(it);
+    const auto byId = m_byId.find(ids.appstreamId);
+    if (byId != m_byId.end() && *byId == res)
+        m_byId.erase(byId);
+    for (const auto &alias : ids.alternatives) {
+        const auto aliased = m_aliases.find(alias);
+        if (aliased != m_aliases.end() && *aliased == ids.appstreamId && !m_byId.contains(ids.appstreamId))
+            m_aliases.erase(aliased);
+    }
+}
+
+void ResourcesDuplicatesIndex::replace(AbstractResource* old, AbstractResource* res)
+{
+    remove(old);
+    insert(res);
+}
+
+void ResourcesDuplicatesIndex::clear()
+{
+    m_resources.clear();
+    m_byId.clear();
+    m_aliases.clear();
+}
@@ -0,0 +1,58 @@
+/*
+ *   SPDX-FileCopyrightText: 2021 Wang Rui <wangrui@jingos.com>
+ *   SPDX-License-Identifier: GPL-2.0-only OR GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+ */
+
+#ifndef RESOURCESDUPLICATESINDEX_H
+#define RESOURCESDUPLICATESINDEX_H
+
+#include <QHash>
+#include <QSet>
+#include <QString>
+
+#include "discovercommon_export.h"
+
+class AbstractResource;
+
+/**
+ * Keeps track of the appstream ids of a set of resources so that a new
+ * resource can be matched against all of them in constant time.
+ *
+ * A resource matches another one when its appstream id or any of its
+ * alternative ids is either the appstream id or an alternative id of the
+ * other one. The ids of every indexed resource are only queried once.
+ */
+class DISCOVERCOMMON_EXPORT ResourcesDuplicatesIndex
+{
+public:
+    /**
+     * @returns the indexed resource @p res is a duplicate of. If there is none
+     * @p res gets indexed and nullptr is returned.
+     */
+    AbstractResource* findOrInsert(AbstractResource* res);
+
+    void insert(AbstractResource* res);
+    void remove(AbstractResource* res);
+    void replace(AbstractResource* old, AbstractResource* res);
+    void clear();
+
+    int count() const {
+        return m_resources.count();
+    }
+
+private:
+    struct Ids {
+        QString appstreamId;
+        QSet<QString> alternatives;
+    };
+
+    static Ids idsFor(AbstractResource* res);
+    AbstractResource* findId(const QString& id) const;
+    void insert(AbstractResource* res, const Ids& ids);
+
+    QHash<AbstractResource*, Ids> m_resources;
+    QHash<QString, AbstractResource*> m_byId;
+    QHash<QString, QString> m_aliases;
+};
+
+#endif
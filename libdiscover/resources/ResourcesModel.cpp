@@ -132,7 +132,16 @@ void ResourcesModel::addResourcesBackend(AbstractResourcesBackend* backend)
 
     connect(backend, &AbstractResourcesBackend::fetchingChanged, this, &ResourcesModel::callerFetchingChanged);
     connect(backend, &AbstractResourcesBackend::allDataChanged, this, &ResourcesModel::updateCaller);
-    connect(backend, &AbstractResourcesBackend::resourcesChanged, this, &ResourcesModel::resourceDataChanged);
+    connect(backend, &AbstractResourcesBackend::resourcesChanged, this, [this](AbstractResource* resource, const QVector<QByteArray>& properties) {
+        static const QVector<QByteArray> filtered = { "categories", "section", "packageName", "appstreamId" };
+        for (const QByteArray& property : properties) {
+            if (filtered.contains(property)) {
+                resource->invalidateCategoryMatches();
+                break;
+            }
+        }
+        Q_EMIT resourceDataChanged(resource, properties);
+    });
     connect(backend, &AbstractResourcesBackend::updatesCountChanged, this, [this] { m_updatesCount.reevaluate(); });
     connect(backend, &AbstractResourcesBackend::fetchingUpdatesProgressChanged, this, [this] { m_fetchingUpdatesProgress.reevaluate(); });
     connect(backend, &AbstractResourcesBackend::resourceRemoved, this, &ResourcesModel::resourceRemoved);
@@ -324,6 +333,10 @@ AggregatedResultsStream::AggregatedResultsStream(const QSet<ResultsStream*>& str
         connect(stream, &ResultsStream::resourcesFound, this, &AggregatedResultsStream::addResults);
         connect(stream, &QObject::destroyed, this, &AggregatedResultsStream::streamDestruction);
         connect(this, &ResultsStream::fetchMore, stream, &ResultsStream::fetchMore);
+        connect(stream, &ResultsStream::stale, this, &ResultsStream::markStale);
+        connect(stream, &ResultsStream::waitingForMoreChanged, this, [this, stream](bool waiting) {
+            streamWaiting(stream, waiting);
+        });
         m_streams << stream;
     }
 
@@ -331,7 +344,12 @@ AggregatedResultsStream::AggregatedResultsStream(const QSet<ResultsStream*>& str
     connect(&m_delayedEmission, &QTimer::timeout, this, &AggregatedResultsStream::emitResults);
 }
 
-AggregatedResultsStream::~AggregatedResultsStream() = default;
+AggregatedResultsStream::~AggregatedResultsStream()
+{
+    // nobody is going to ask them for more
+    for (QObject* stream : qAsConst(m_waiting))
+        stream->deleteLater();
+}
 
 void AggregatedResultsStream::addResults(const QVector<AbstractResource *>& res)
 {
@@ -361,9 +379,24 @@ void AggregatedResultsStream::resourceDestruction(QObject* obj)
 void AggregatedResultsStream::streamDestruction(QObject* obj)
 {
     m_streams.remove(obj);
+    streamWaiting(obj, false);
     clear();
 }
 
+void AggregatedResultsStream::streamWaiting(QObject* stream, bool waiting)
+{
+    if (waiting)
+        m_waiting.insert(stream);
+    else
+        m_waiting.remove(stream);
+
+    // waits once every stream still running does, the page they found is shown first
+    const bool all = !m_streams.isEmpty() && m_waiting.size() == m_streams.size();
+    if (all)
+        emitResults();
+    setWaitingForMore(all);
+}
+
 void AggregatedResultsStream::clear()
 {
     if (m_streams.isEmpty()) {
@@ -375,7 +408,8 @@ void AggregatedResultsStream::clear()
 
 AggregatedResultsStream* ResourcesModel::search(const AbstractResourcesBackend::Filters& search)
 {
-    if (search.isEmpty() || networkState() == "1") {
+    // offline the backends answer from what they have locally
+    if (search.isEmpty()) {
         return new AggregatedResultsStream ({new ResultsStream(QStringLiteral("emptysearch"), {})});
     }
 
@@ -36,8 +36,11 @@ private:
     void streamDestruction(QObject* obj);
     void resourceDestruction(QObject* obj);
     void clear();
+    void streamWaiting(QObject* stream, bool waiting);
 
     QSet<QObject*> m_streams;
+    // streams that only go on after fetchMore()
+    QSet<QObject*> m_waiting;
     QVector<AbstractResource*> m_results;
     QTimer m_delayedEmission;
 };
@@ -10,13 +10,20 @@
 #include "libdiscover_debug.h"
 #include <QMetaProperty>
 #include <utils.h>
+#include <memory>
+#include <functional>
+#include <iterator>
 
 #include "ResourcesModel.h"
 #include <Category/CategoryModel.h>
 #include <ReviewsBackend/Rating.h>
 #include <Transaction/TransactionModel.h>
+#include <network/ImageCache.h>
 #include <QNetworkConfigurationManager>
 
+// more runs of new rows in one batch than this and the view is reset instead
+#define MAX_INSERTED_RUNS 16
+
 ResourcesProxyModel::ResourcesProxyModel(QObject *parent)
     : QAbstractListModel(parent)
     , m_sortRole(NameRole)
@@ -53,7 +60,12 @@ ResourcesProxyModel::ResourcesProxyModel(QObject *parent)
     connect(ResourcesModel::global(), &ResourcesModel::backendsChanged, this, &ResourcesProxyModel::invalidateFilter);
     connect(ResourcesModel::global(), &ResourcesModel::backendDataChanged, this, &ResourcesProxyModel::refreshBackend);
     // connect(ResourcesModel::global(), &ResourcesModel::resourceDataChanged, this, &ResourcesProxyModel::refreshResource);
+    connect(ResourcesModel::global(), &ResourcesModel::resourceDataChanged, this, &ResourcesProxyModel::invalidateSortKey);
     connect(ResourcesModel::global(), &ResourcesModel::resourceRemoved, this, &ResourcesProxyModel::removeResource);
+    connect(ResourcesModel::global(), &ResourcesModel::networkStateChanged, this, [this](const QString &state) {
+        if (state == QLatin1String("2"))
+            refreshStale();
+    });
 
     connect(this, &QAbstractItemModel::modelReset, this, &ResourcesProxyModel::countChanged);
     connect(this, &QAbstractItemModel::rowsInserted, this, &ResourcesProxyModel::countChanged);
@@ -74,9 +86,10 @@ QHash<int, QByteArray> ResourcesProxyModel::roleNames() const
 void ResourcesProxyModel::setSortRole(Roles sortRole)
 {
     if (sortRole != m_sortRole) {
-        Q_ASSERT(roleNames().contains(sortRole));
+        Q_ASSERT(m_roles.contains(sortRole));
 
         m_sortRole = sortRole;
+        m_sortKeys.clear();
         Q_EMIT sortRoleChanged(sortRole);
         invalidateSorting();
     }
@@ -112,104 +125,53 @@ void ResourcesProxyModel::setSearch(const QString &_searchText)
 void ResourcesProxyModel::removeDuplicates(QVector<AbstractResource *>& resources)
 {
     const auto cab = ResourcesModel::global()->currentApplicationBackend();
-    QHash<QString, QString> aliases;
-    QHash<QString, QVector<AbstractResource *>::iterator> storedIds;
-    for (auto it = m_displayedResources.begin(); it != m_displayedResources.end(); ++it)
+    // what is accepted from this batch gets indexed as well but is not displayed yet, by its position in the batch
+    QHash<AbstractResource*, int> accepted;
+    // displayed resources to be swapped for the one of the current backend, applied in one pass at the end
+    QHash<AbstractResource*, AbstractResource*> replacements;
+    // replacement -> the displayed resource it stands in for
+    QHash<AbstractResource*, AbstractResource*> replaced;
+    int out = 0;
+    for (int i = 0; i < resources.count(); ++i)
     {
-        const auto appstreamid = (*it)->appstreamId();
-        if (appstreamid.isEmpty()) {
+        AbstractResource* const res = resources.at(i);
+        AbstractResource* const found = m_duplicates.findOrInsert(res);
+        if (!found) {
+            accepted.insert(res, out);
+            resources[out++] = res;
             continue;
         }
-        auto at = storedIds.find(appstreamid);
-        if (at == storedIds.end()) {
-            storedIds[appstreamid] = it;
-        } else {
-            qCWarning(LIBDISCOVER_LOG) << "We should have sanitized the displayed resources. There is a bug";
-            Q_UNREACHABLE();
-        }
-
-        const auto alts = (*it)->alternativeAppstreamIds();
-        for (const auto &alias : alts) {
-            aliases[alias] = appstreamid;
-        }
-    }
 
-    QHash<QString, QVector<AbstractResource *>::iterator> ids;
-    for (auto it = resources.begin(); it != resources.end(); )
-    {
-        const auto appstreamid = (*it)->appstreamId();
-        if (appstreamid.isEmpty()) {
-            ++it;
+        if (found == res || res->backend() != cab) {
+            if (found != res)
+                m_sortKeys.remove(res);
             continue;
         }
-        auto at = storedIds.find(appstreamid);
-        if (at == storedIds.end()) {
-            auto aliased = aliases.constFind(appstreamid);
-            if (aliased != aliases.constEnd()) {
-                at = storedIds.find(aliased.value());
-            }
-        }
-
-        if (at == storedIds.end()) {
-            const auto alts = (*it)->alternativeAppstreamIds();
-            for (const auto &alt : alts) {
-                at = storedIds.find(alt);
-                if (at == storedIds.end())
-                    break;
-
-                auto aliased = aliases.constFind(alt);
-                if (aliased != aliases.constEnd()) {
-                    at = storedIds.find(aliased.value());
-                    if (at != storedIds.end())
-                        break;
-                }
-            }
-        }
-        if (at == storedIds.end()) {
-            auto at = ids.find(appstreamid);
-            if (at == ids.end()) {
-                auto aliased = aliases.constFind(appstreamid);
-                if (aliased != aliases.constEnd()) {
-                    at = ids.find(aliased.value());
-                }
-            }
-            if (at == ids.end()) {
-                const auto alts = (*it)->alternativeAppstreamIds();
-                for (const auto &alt : alts) {
-                    at = ids.find(alt);
-                    if (at != ids.end())
-                        break;
-
-                    auto aliased = aliases.constFind(appstreamid);
-                    if (aliased != aliases.constEnd()) {
-                        at = ids.find(aliased.value());
-                        if (at != ids.end())
-                            break;
-                    }
-                }
-            }
-            if (at == ids.end()) {
-                ids[appstreamid] = it;
-                const auto alts = (*it)->alternativeAppstreamIds();
-                for (const auto &alias : alts) {
-                    aliases[alias] = appstreamid;
-                }
-                ++it;
-            } else {
-                if ((*it)->backend() == cab) {
-                    qSwap(*it, **at);
-                }
-                it = resources.erase(it);
-            }
+        m_duplicates.replace(found, res);
+        m_sortKeys.remove(found);
+        const int pos = accepted.value(found, -1);
+        if (pos >= 0) {
+            accepted.remove(found);
+            accepted.insert(res, pos);
+            resources[pos] = res;
         } else {
-            if ((*it)->backend() == cab) {
-                **at = *it;
-                auto pos = index(*at - m_displayedResources.begin(), 0);
-                Q_EMIT dataChanged(pos, pos);
-            }
-            it = resources.erase(it);
+            AbstractResource* const displayed = replaced.take(found);
+            replacements[displayed ? displayed : found] = res;
+            replaced.insert(res, displayed ? displayed : found);
         }
     }
+    resources.resize(out);
+
+    if (replacements.isEmpty())
+        return;
+    for (int row = 0, count = m_displayedResources.count(); row < count; ++row) {
+        const auto replacement = replacements.constFind(m_displayedResources.at(row));
+        if (replacement == replacements.constEnd())
+            continue;
+        m_displayedResources[row] = *replacement;
+        const auto pos = index(row, 0);
+        Q_EMIT dataChanged(pos, pos);
+    }
 }
 
 void ResourcesProxyModel::addResources(const QVector<AbstractResource *>& _res)
@@ -273,20 +235,22 @@ void ResourcesProxyModel::setFiltersFromCategory(Category *category)
 
 void ResourcesProxyModel::fetchSubcategories()
 {
-    auto cats = kToSet(m_filters.category ? m_filters.category->subCategories() : CategoryModel::global()->rootCategories());
+    const auto cats = m_filters.category ? m_filters.category->subCategories() : CategoryModel::global()->rootCategories();
 
-    const int count = rowCount();
-    QSet<Category*> done;
-    for (int i=0; i<count && !cats.isEmpty(); ++i) {
-        AbstractResource* res = m_displayedResources[i];
-        const auto found = res->categoryObjects(kSetToVector(cats));
-        done.unite(found);
-        cats.subtract(found);
-    }
+    // the matches are cached in every resource, only bits are looked at here
+    QBitArray leaves;
+    for (AbstractResource* res : qAsConst(m_displayedResources))
+        res->addCategoryLeaves(cats, leaves);
 
-    const QVariantList ret = kTransform<QVariantList>(done, [](Category* cat) {
-        return QVariant::fromValue<QObject*>(cat);
-    });
+    QVariantList ret;
+    std::function<void(const QVector<Category*>&)> collect = [&](const QVector<Category*>& categories) {
+        for (Category* cat : categories) {
+            if (cat->index() < leaves.size() && leaves.testBit(cat->index()))
+                ret += QVariant::fromValue<QObject*>(cat);
+            collect(cat->subCategories());
+        }
+    };
+    collect(cats);
     if (ret != m_subcategories) {
         m_subcategories = ret;
         Q_EMIT subcategoriesChanged(m_subcategories);
@@ -317,7 +281,10 @@ void ResourcesProxyModel::invalidateFilter()
 
     m_currentStream = ResourcesModel::global()->search(m_filters);
     Q_EMIT busyChanged(true);
+    setStale(false);
 
+    m_duplicates.clear();
+    m_sortKeys.clear();
     if (!m_displayedResources.isEmpty()) {
         beginResetModel();
         m_displayedResources.clear();
@@ -325,6 +292,17 @@ void ResourcesProxyModel::invalidateFilter()
     }
 
     connect(m_currentStream, &AggregatedResultsStream::resourcesFound, this, &ResourcesProxyModel::addResources);
+    watchStream();
+}
+
+void ResourcesProxyModel::watchStream()
+{
+    connect(m_currentStream, &ResultsStream::stale, this, [this] {
+        setStale(true);
+    });
+    connect(m_currentStream, &ResultsStream::waitingForMoreChanged, this, [this] {
+        Q_EMIT busyChanged(isBusy());
+    });
     connect(m_currentStream, &AggregatedResultsStream::finished, this, [this]() {
         m_currentStream = nullptr;
         qDebug()<<Q_FUNC_INFO << " busy finished:" << m_currentStream;
@@ -332,36 +310,142 @@ void ResourcesProxyModel::invalidateFilter()
     });
 }
 
+void ResourcesProxyModel::refreshStale()
+{
+    if (!m_stale || isBusy() || !m_setup) {
+        return;
+    }
+
+    // unlike invalidateFilter() the offline results stay until the fresh ones arrive
+    delete m_currentStream;
+    m_currentStream = ResourcesModel::global()->search(m_filters);
+    Q_EMIT busyChanged(true);
+    setStale(false);
+
+    auto replaced = std::make_shared<bool>(false);
+    connect(m_currentStream, &AggregatedResultsStream::resourcesFound, this, [this, replaced](const QVector<AbstractResource*> &resources) {
+        if (!*replaced) {
+            *replaced = true;
+            m_duplicates.clear();
+            m_sortKeys.clear();
+            beginResetModel();
+            m_displayedResources.clear();
+            endResetModel();
+        }
+        addResources(resources);
+    });
+    watchStream();
+}
+
+void ResourcesProxyModel::setStale(bool stale)
+{
+    if (m_stale != stale) {
+        m_stale = stale;
+        Q_EMIT staleChanged(stale);
+    }
+}
+
 int ResourcesProxyModel::rowCount(const QModelIndex& parent) const
 {
     return parent.isValid() ? 0 : m_displayedResources.count();
 }
 
+static bool hasSortKey(ResourcesProxyModel::Roles role)
+{
+    switch (role) {
+    case ResourcesProxyModel::RatingRole:
+    case ResourcesProxyModel::RatingPointsRole:
+    case ResourcesProxyModel::RatingCountRole:
+    case ResourcesProxyModel::SortableRatingRole:
+    case ResourcesProxyModel::SizeRole:
+    case ResourcesProxyModel::ReleaseDateRole:
+    case ResourcesProxyModel::CanUpgrade:
+    case ResourcesProxyModel::InstalledRole:
+    case ResourcesProxyModel::StateRole:
+        return true;
+    default:
+        return false;
+    }
+}
+
+double ResourcesProxyModel::sortKey(AbstractResource* resource) const
+{
+    const auto it = m_sortKeys.constFind(resource);
+    if (it != m_sortKeys.constEnd())
+        return *it;
+
+    double key = 0;
+    switch (m_sortRole) {
+    case RatingRole:
+    case RatingPointsRole:
+    case RatingCountRole:
+    case SortableRatingRole: {
+        const Rating* rating = resource->rating();
+        if (!rating)
+            break;
+        if (m_sortRole == RatingRole)
+            key = rating->rating();
+        else if (m_sortRole == RatingPointsRole)
+            key = rating->ratingPoints();
+        else if (m_sortRole == RatingCountRole)
+            key = rating->ratingCount();
+        else
+            key = rating->sortableRating();
+        break;
+    }
+    case SizeRole:
+        key = resource->size();
+        break;
+    case ReleaseDateRole:
+        key = resource->releaseDate().toJulianDay();
+        break;
+    case CanUpgrade:
+        key = resource->canUpgrade();
+        break;
+    case InstalledRole:
+        key = resource->isInstalled();
+        break;
+    case StateRole:
+        key = resource->state();
+        break;
+    default:
+        Q_UNREACHABLE();
+    }
+    m_sortKeys.insert(resource, key);
+    return key;
+}
+
+void ResourcesProxyModel::invalidateSortKey(AbstractResource* resource, const QVector<QByteArray>& properties)
+{
+    if (properties.contains(m_roles.value(m_sortRole)))
+        m_sortKeys.remove(resource);
+}
+
 bool ResourcesProxyModel::lessThan(AbstractResource* leftPackage, AbstractResource* rightPackage) const
 {
     auto role = m_sortRole;
     Qt::SortOrder order = m_sortOrder;
-    QVariant leftValue;
-    QVariant rightValue;
     //if we're comparing two equal values, we want the model sorted by application name
     if (role != NameRole) {
-        leftValue = roleToValue(leftPackage, role);
-        rightValue = roleToValue(rightPackage, role);
+        int comparison;
+        if (hasSortKey(role)) {
+            const double leftValue = sortKey(leftPackage);
+            const double rightValue = sortKey(rightPackage);
+            comparison = leftValue < rightValue ? -1 : (rightValue < leftValue ? 1 : 0);
+        } else {
+            const QVariant leftValue = roleToValue(leftPackage, role);
+            const QVariant rightValue = roleToValue(rightPackage, role);
+            comparison = leftValue == rightValue ? 0 : (leftValue < rightValue ? -1 : 1);
+        }
 
-        if (leftValue == rightValue) {
-            role = NameRole;
-            order = Qt::AscendingOrder;
+        if (comparison != 0) {
+            const bool ret = role == CanUpgrade ? comparison > 0 : comparison < 0;
+            return ret != (order != Qt::AscendingOrder);
         }
+        order = Qt::AscendingOrder;
     }
 
-    bool ret;
-    if (role == NameRole) {
-        ret = leftPackage->nameSortKey().compare(rightPackage->nameSortKey()) < 0;
-    } else if (role == CanUpgrade) {
-        ret = leftValue.toBool();
-    } else {
-        ret = leftValue < rightValue;
-    }
+    const bool ret = leftPackage->nameSortKey().compare(rightPackage->nameSortKey()) < 0;
     return ret != (order != Qt::AscendingOrder);
 }
 
@@ -457,9 +541,39 @@ QVariant ResourcesProxyModel::data(const QModelIndex& index, int role) const
     return roleToValue(resource, role);
 }
 
+const QMetaProperty& ResourcesProxyModel::roleProperty(int role) const
+{
+    // every instance has the same roles, the properties are only looked up for the first one
+    static const QVector<QMetaProperty> s_properties = [this] {
+        QVector<QMetaProperty> ret(ReleaseDateRole - NameRole + 1);
+        for (auto it = m_roles.constBegin(), itEnd = m_roles.constEnd(); it != itEnd; ++it) {
+            const bool isRating = it.key() == RatingRole || it.key() == RatingPointsRole
+                               || it.key() == RatingCountRole || it.key() == SortableRatingRole;
+            const QMetaObject& m = isRating ? Rating::staticMetaObject : AbstractResource::staticMetaObject;
+            const int idx = m.indexOfProperty(it.value().constData());
+            if (idx >= 0)
+                ret[it.key() - NameRole] = m.property(idx);
+        }
+        return ret;
+    }();
+    static const QMetaProperty s_invalid;
+
+    if (role < NameRole || role > ReleaseDateRole)
+        return s_invalid;
+    return s_properties.at(role - NameRole);
+}
+
 QVariant ResourcesProxyModel::roleToValue(AbstractResource* resource, int role) const
 {
     switch (role) {
+    case NameRole:
+        return resource->name();
+    case IconRole:
+        return resource->icon();
+    case CommentRole:
+        return resource->comment();
+    case StateRole:
+        return QVariant::fromValue(resource->state());
     case ApplicationRole:
         return QVariant::fromValue<QObject*>(resource);
     case RatingPointsRole:
@@ -467,9 +581,8 @@ QVariant ResourcesProxyModel::roleToValue(AbstractResource* resource, int role)
     case RatingCountRole:
     case SortableRatingRole: {
         Rating* const rating = resource->rating();
-        const int idx = Rating::staticMetaObject.indexOfProperty(roleNames().value(role).constData());
-        Q_ASSERT(idx >= 0);
-        auto prop = Rating::staticMetaObject.property(idx);
+        const QMetaProperty& prop = roleProperty(role);
+        Q_ASSERT(prop.isValid());
         if (rating) {
             return prop.readOnGadget(rating);
         } else {
@@ -484,19 +597,12 @@ QVariant ResourcesProxyModel::roleToValue(AbstractResource* resource, int role)
     case Qt::ToolTipRole:
         return QVariant();
     default: {
-        QByteArray roleText = roleNames().value(role);
-        if (Q_UNLIKELY(roleText.isEmpty())) {
-            qCDebug(LIBDISCOVER_LOG) << "unsupported role" << role;
-            return {};
-        }
-        static const QMetaObject* m = &AbstractResource::staticMetaObject;
-        int propidx = roleText.isEmpty() ? -1 : m->indexOfProperty(roleText.constData());
-
-        if (Q_UNLIKELY(propidx < 0)) {
-            qCWarning(LIBDISCOVER_LOG) << "unknown role:" << role << roleText;
+        const QMetaProperty& prop = roleProperty(role);
+        if (Q_UNLIKELY(!prop.isValid())) {
+            qCWarning(LIBDISCOVER_LOG) << "unknown role:" << role << m_roles.value(role);
             return QVariant();
-        } else
-            return m->property(propidx).read(resource);
+        }
+        return prop.read(resource);
     }
     }
 }
@@ -522,6 +628,9 @@ void ResourcesProxyModel::sortedInsertion(const QVector<AbstractResource*> & _re
         removeDuplicates(resources);
         if (resources.isEmpty())
             return;
+    } else {
+        for (auto resource : qAsConst(resources))
+            m_duplicates.insert(resource);
     }
 
     if (m_sortByRelevancy || m_displayedResources.isEmpty()) {
@@ -533,21 +642,62 @@ void ResourcesProxyModel::sortedInsertion(const QVector<AbstractResource*> & _re
         return;
     }
 
+    // addResources sorted the batch, so where each of its resources goes is found in a single pass
+    QVector<AbstractResource*> added;
+    QVector<int> before; // row of m_displayedResources the added resource goes in front of
+    added.reserve(resources.count());
+    before.reserve(resources.count());
+    const auto finder = [this](AbstractResource* resource, AbstractResource* res) {
+        return lessThan(resource, res);
+    };
+    const auto begin = m_displayedResources.constBegin();
+    const auto end = m_displayedResources.constEnd();
+    auto it = begin;
+    int runs = 0;
     for (auto resource: qAsConst(resources)) {
-        const auto finder = [this](AbstractResource* resource, AbstractResource* res) {
-            return lessThan(resource, res);
-        };
-        const auto it = std::upper_bound(m_displayedResources.constBegin(), m_displayedResources.constEnd(), resource, finder);
-        const auto newIdx = it == m_displayedResources.constEnd() ? m_displayedResources.count() : (it - m_displayedResources.constBegin());
-
-        if ((it-1) != m_displayedResources.constEnd() && *(it-1) == resource)
+        it = std::upper_bound(it, end, resource, finder);
+        if (it != begin && *(it-1) == resource)
             continue;
 
-        beginInsertRows({}, newIdx, newIdx);
-        m_displayedResources.insert(newIdx, resource);
-        endInsertRows();
-//         Q_ASSERT(isSorted(resources));
+        const int row = it - begin;
+        if (before.isEmpty() || before.constLast() != row)
+            ++runs;
+        added += resource;
+        before += row;
+    }
+    if (added.isEmpty())
+        return;
+
+    if (runs <= MAX_INSERTED_RUNS) {
+        // every run of new rows that end up next to each other is inserted at once
+        int first = 0;
+        for (int i = 1; i <= added.count(); ++i) {
+            if (i < added.count() && before.at(i) == before.at(first))
+                continue;
+            const int row = before.at(first) + first;
+            beginInsertRows({}, row, row + i - first - 1);
+            m_displayedResources.insert(row, i - first, nullptr);
+            std::copy(added.constBegin() + first, added.constBegin() + i, m_displayedResources.begin() + row);
+            endInsertRows();
+            first = i;
+        }
+    } else {
+        // spread all over the list, moving the tail for each run would be quadratic
+        QVector<AbstractResource*> merged;
+        merged.reserve(m_displayedResources.count() + added.count());
+        int from = 0;
+        for (int i = 0; i < added.count(); ++i) {
+            std::copy(m_displayedResources.constBegin() + from, m_displayedResources.constBegin() + before.at(i), std::back_inserter(merged));
+            from = before.at(i);
+            merged += added.at(i);
+        }
+        std::copy(m_displayedResources.constBegin() + from, m_displayedResources.constEnd(), std::back_inserter(merged));
+
+        beginResetModel();
+        m_displayedResources.swap(merged);
+        endResetModel();
     }
+//     Q_ASSERT(isSorted(m_displayedResources));
 }
 void ResourcesProxyModel::refreshResource(AbstractResource* resource, const QVector<QByteArray>& properties)
 {
@@ -562,6 +712,8 @@ void ResourcesProxyModel::refreshResource(AbstractResource* resource, const QVec
     if (!m_filters.shouldFilter(resource)) {
         beginRemoveRows({}, residx, residx);
         m_displayedResources.removeAt(residx);
+        m_duplicates.remove(resource);
+        m_sortKeys.remove(resource);
         endRemoveRows();
         return;
     }
@@ -572,6 +724,8 @@ void ResourcesProxyModel::refreshResource(AbstractResource* resource, const QVec
     if (!m_sortByRelevancy && roles.contains(m_sortRole)) {
         beginRemoveRows({}, residx, residx);
         m_displayedResources.removeAt(residx);
+        m_duplicates.remove(resource);
+        m_sortKeys.remove(resource);
         endRemoveRows();
 
         sortedInsertion({resource});
@@ -586,6 +740,8 @@ void ResourcesProxyModel::removeResource(AbstractResource* resource)
         return;
     beginRemoveRows({}, residx, residx);
     m_displayedResources.removeAt(residx);
+    m_duplicates.remove(resource);
+    m_sortKeys.remove(resource);
     endRemoveRows();
 }
 
@@ -610,6 +766,7 @@ void ResourcesProxyModel::refreshBackend(AbstractResourcesBackend* backend, cons
     }
 
     if (found && properties.contains(m_roles.value(m_sortRole))) {
+        m_sortKeys.clear();
         invalidateSorting();
     }
 }
@@ -617,7 +774,7 @@ void ResourcesProxyModel::refreshBackend(AbstractResourcesBackend* backend, cons
 QVector<int> ResourcesProxyModel::propertiesToRoles(const QVector<QByteArray>& properties) const
 {
     QVector<int> roles = kTransform<QVector<int>>(properties, [this](const QByteArray& arr) {
-        return roleNames().key(arr, -1);
+        return m_roles.key(arr, -1);
     });
     roles.removeAll(-1);
     return roles;
@@ -650,20 +807,49 @@ AbstractResource * ResourcesProxyModel::findIndexByName(QString appName)
     return {};
 }
 
+bool ResourcesProxyModel::isBusy() const
+{
+    return m_currentStream && !m_currentStream->isWaitingForMore();
+}
+
+bool ResourcesProxyModel::hasMore() const
+{
+    return m_currentStream && m_currentStream->isWaitingForMore();
+}
+
 bool ResourcesProxyModel::canFetchMore(const QModelIndex& parent) const
 {
     Q_ASSERT(!parent.isValid());
-    return m_currentStream;
+    return hasMore();
 }
 
 void ResourcesProxyModel::fetchMore(const QModelIndex& parent)
 {
     Q_ASSERT(!parent.isValid());
-    if (!m_currentStream)
+    fetchMoreResources();
+}
+
+void ResourcesProxyModel::fetchMoreResources()
+{
+    if (!hasMore())
         return;
     Q_EMIT m_currentStream->fetchMore();
 }
 
+void ResourcesProxyModel::prefetchIcons(int first, int count)
+{
+    QList<QUrl> urls;
+    const int last = qMin(first + count, m_displayedResources.count());
+    for (int row = qMax(0, first); row < last; ++row) {
+        const QUrl url = m_displayedResources.at(row)->icon().toUrl();
+        // icon names and local files are cheap already
+        if (url.scheme() == QLatin1String("http") || url.scheme() == QLatin1String("https"))
+            urls += url;
+    }
+    if (!urls.isEmpty())
+        ImageCache::global()->prefetchOriginals(urls);
+}
+
 bool ResourcesProxyModel::sortByRelevancy() const
 {
     return m_sortByRelevancy;
@@ -18,8 +18,10 @@
 #include "discovercommon_export.h"
 #include "AbstractResource.h"
 #include "AbstractResourcesBackend.h"
+#include "ResourcesDuplicatesIndex.h"
 
 class AggregatedResultsStream;
+class QMetaProperty;
 
 class DISCOVERCOMMON_EXPORT ResourcesProxyModel : public QAbstractListModel, public QQmlParserStatus
 {
@@ -40,6 +42,8 @@ class DISCOVERCOMMON_EXPORT ResourcesProxyModel : public QAbstractListModel, pub
     Q_PROPERTY(bool isBusy READ isBusy NOTIFY busyChanged)
     Q_PROPERTY(int count READ rowCount NOTIFY countChanged)
     Q_PROPERTY(bool sortByRelevancy READ sortByRelevancy NOTIFY sortByRelevancyChanged)
+    Q_PROPERTY(bool stale READ isStale NOTIFY staleChanged)
+    Q_PROPERTY(bool hasMore READ hasMore NOTIFY busyChanged)
 public:
     explicit ResourcesProxyModel(QObject* parent = nullptr);
     enum Roles {
@@ -110,9 +114,16 @@ public:
     Q_SCRIPTABLE int indexOf(AbstractResource* res);
     Q_SCRIPTABLE AbstractResource* resourceAt(int row) const;
     Q_SCRIPTABLE AbstractResource* findIndexByName(QString appName);
+    /// inserts @p res where they sort, a duplicate of a shown resource takes its row
+    void addResources(const QVector<AbstractResource*> &res);
 
-    bool isBusy() const {
-        return m_currentStream != nullptr;
+    /// looking for results, not while the stream waits to be asked for more
+    bool isBusy() const;
+    /// the backends have more results, see fetchMoreResources()
+    bool hasMore() const;
+    /// the results were answered from local data while offline
+    bool isStale() const {
+        return m_stale;
     }
 
     bool lessThan(AbstractResource* rl, AbstractResource* rr) const;
@@ -122,20 +133,30 @@ public:
 
     bool canFetchMore(const QModelIndex & parent) const override;
     void fetchMore(const QModelIndex & parent) override;
+    /// fetchMore() for views that ask before reaching the end
+    Q_SCRIPTABLE void fetchMoreResources();
+    /// downloads the remote icons of the rows from @p first on ahead of time, for the ones past the viewport
+    Q_SCRIPTABLE void prefetchIcons(int first, int count);
     bool sortByRelevancy() const;
 
     void classBegin() override {}
     void componentComplete() override;
+public Q_SLOTS:
+    void removeResource(AbstractResource* resource);
 private Q_SLOTS:
     void refreshBackend(AbstractResourcesBackend* backend, const QVector<QByteArray>& properties);
     void refreshResource(AbstractResource* resource, const QVector<QByteArray>& properties);
-    void removeResource(AbstractResource* resource);
+    void invalidateSortKey(AbstractResource* resource, const QVector<QByteArray>& properties);
+    void refreshStale();
 private:
+    void setStale(bool stale);
+    void watchStream();
     void sortedInsertion(const QVector<AbstractResource*> &res);
     QVariant roleToValue(AbstractResource* res, int role) const;
+    const QMetaProperty& roleProperty(int role) const;
+    double sortKey(AbstractResource* resource) const;
 
     QVector<int> propertiesToRoles(const QVector<QByteArray>& properties) const;
-    void addResources(const QVector<AbstractResource*> &res);
     void fetchSubcategories();
     void removeDuplicates(QVector<AbstractResource *>& newResources);
     bool isSorted(const QVector<AbstractResource*> & resources);
@@ -145,11 +166,15 @@ private:
 
     bool m_sortByRelevancy;
     bool m_setup = false;
+    bool m_stale = false;
 
     AbstractResourcesBackend::Filters m_filters;
     QVariantList m_subcategories;
 
     QVector<AbstractResource*> m_displayedResources;
+    ResourcesDuplicatesIndex m_duplicates;
+    // typed value of m_sortRole for every resource compared so far
+    mutable QHash<AbstractResource*, double> m_sortKeys;
     const QHash<int, QByteArray> m_roles;
     AggregatedResultsStream* m_currentStream;
 
@@ -165,6 +190,7 @@ Q_SIGNALS:
     void countChanged();
     void filterMinimumStateChanged(bool filterMinimumState);
     void sortByRelevancyChanged(bool sortByRelevancy);
+    void staleChanged(bool stale);
 };
 
 #endif
@@ -0,0 +1,106 @@
+/*
+ *   SPDX-FileCopyrightText: 2021 Wang Rui <wangrui@jingos.com>
+ *   SPDX-License-Identifier: GPL-2.0-only OR GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+ */
+
+#include "StringPool.h"
+
+#include <QFile>
+#include <unistd.h>
+
+StringPool* StringPool::global()
+{
+    static StringPool s_pool;
+    return &s_pool;
+}
+
+QString StringPool::intern(const QString& string)
+{
+    if (string.isEmpty())
+        return {};
+
+    const uint hash = qHash(QStringView(string));
+    QMutexLocker locker(&m_mutex);
+    ++m_stats.lookups;
+    for (auto it = m_strings.constFind(hash); it != m_strings.constEnd() && it.key() == hash; ++it) {
+        if (*it == string) {
+            ++m_stats.hits;
+            if (!it->isSharedWith(string))
+                m_stats.bytesSaved += string.size() * sizeof(QChar);
+            return *it;
+        }
+    }
+    // strings built with += keep their spare capacity, the pool does not
+    return insert(hash, string.capacity() > string.size() ? QString(string.constData(), string.size()) : string);
+}
+
+QString StringPool::intern(QStringView string)
+{
+    if (string.isEmpty())
+        return {};
+
+    const uint hash = qHash(string);
+    QMutexLocker locker(&m_mutex);
+    ++m_stats.lookups;
+    for (auto it = m_strings.constFind(hash); it != m_strings.constEnd() && it.key() == hash; ++it) {
+        if (QStringView(*it) == string) {
+            ++m_stats.hits;
+            m_stats.bytesSaved += string.size() * sizeof(QChar);
+            return *it;
+        }
+    }
+    return insert(hash, string.toString());
+}
+
+QString StringPool::insert(uint hash, const QString& string)
+{
+    m_strings.insert(hash, string);
+    ++m_stats.strings;
+    m_stats.bytes += string.size() * sizeof(QChar);
+    return string;
+}
+
+int StringPool::squeeze()
+{
+    QMutexLocker locker(&m_mutex);
+    int removed = 0;
+    for (auto it = m_strings.begin(); it != m_strings.end();) {
+        if (it->isDetached()) {
+            m_stats.bytes -= it->size() * sizeof(QChar);
+            it = m_strings.erase(it);
+            ++removed;
+        } else {
+            ++it;
+        }
+    }
+    m_stats.strings -= removed;
+    return removed;
+}
+
+StringPool::Stats StringPool::stats() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_stats;
+}
+
+static qint64 residentBytes()
+{
+    QFile statm(QStringLiteral("/proc/self/statm"));
+    if (!statm.open(QIODevice::ReadOnly))
+        return -1;
+    const QList<QByteArray> fields = statm.readAll().split(' ');
+    return fields.size() > 1 ? fields[1].toLongLong() * sysconf(_SC_PAGESIZE) : -1;
+}
+
+QVariantMap StringPool::report() const
+{
+    const Stats s = stats();
+    return {
+        { QStringLiteral("strings"), s.strings },
+        { QStringLiteral("bytes"), s.bytes },
+        { QStringLiteral("lookups"), s.lookups },
+        { QStringLiteral("hits"), s.hits },
+        { QStringLiteral("bytesSaved"), s.bytesSaved },
+        { QStringLiteral("residentBytes"), residentBytes() },
+    };
+}
@@ -0,0 +1,58 @@
+/*
+ *   SPDX-FileCopyrightText: 2021 Wang Rui <wangrui@jingos.com>
+ *   SPDX-License-Identifier: GPL-2.0-only OR GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+ */
+
+#ifndef STRINGPOOL_H
+#define STRINGPOOL_H
+
+#include <QMultiHash>
+#include <QMutex>
+#include <QString>
+#include <QVariantMap>
+
+#include "discovercommon_export.h"
+
+/**
+ * One copy of every metadata string, shared by whoever interns it.
+ *
+ * The catalog, every applist page and every snapshot lookup decode the same
+ * names, icons and categories again. Interned, the server catalog and the
+ * resources showing it hold the same immutable QString data instead of a
+ * copy each. It can be used from any thread.
+ */
+class DISCOVERCOMMON_EXPORT StringPool
+{
+public:
+    struct Stats {
+        int strings = 0;
+        /// held by the pool
+        qint64 bytes = 0;
+        qint64 lookups = 0;
+        qint64 hits = 0;
+        /// what the hits did not allocate again
+        qint64 bytesSaved = 0;
+    };
+
+    static StringPool* global();
+
+    QString intern(const QString& string);
+    /// Only allocates for strings that are not in the pool yet
+    QString intern(QStringView string);
+    /// Drops the strings nobody else holds anymore, @returns how many
+    int squeeze();
+
+    Stats stats() const;
+    /// stats() and the resident set of the process
+    QVariantMap report() const;
+
+private:
+    QString insert(uint hash, const QString& string);
+
+    mutable QMutex m_mutex;
+    // by qHash() of their contents
+    QMultiHash<uint, QString> m_strings;
+    Stats m_stats;
+};
+
+#endif
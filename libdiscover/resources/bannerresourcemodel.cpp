@@ -4,11 +4,13 @@
  */
 #include "bannerresourcemodel.h"
 #include "network/HttpClient.h"
+#include "ResourcesModel.h"
 #include <QJsonDocument>
 #include <QJsonArray>
 #include <QJsonObject>
 #include <QFile>
 #include <QLocale>
+#include <QSaveFile>
 
 LocalBannerThread::LocalBannerThread()
 {
@@ -47,6 +49,12 @@ BannerResourceModel::BannerResourceModel()
         currentLang = "en";
     }
     loadBannerData();
+    // offline the banners came from bannersinfo.json, ask again once back online
+    connect(ResourcesModel::global(), &ResourcesModel::networkStateChanged, this, [this](const QString &state) {
+        if (state == QLatin1String("2") && !netWorkSuc) {
+            requestBanners();
+        }
+    });
 }
 
 BannerResourceModel * BannerResourceModel::global()
@@ -83,73 +91,92 @@ void BannerResourceModel::loadBannerData()
     connect(localThread, &LocalBannerThread::loadLocalSuc,this, &BannerResourceModel::createbannerData);
     connect(this, &BannerResourceModel::networkStop,localThread, &LocalBannerThread::onNetworkStop);
 
+    requestBanners();
+    localThread->start();
+}
+
+void BannerResourceModel::requestBanners()
+{
     HttpClient::global() -> get(QLatin1String(BASE_URL) + QLatin1String(BANNER_URL))
     .header("content-type", "application/json")
     .queryParam("label", "banner")
-    .onResponse([this](QByteArray result) {
-        if (result.isEmpty()) {
+    .cachePolicy(HttpRequest::StaleWhileRevalidate)
+    .priority(HttpRequest::Prefetch)
+    .onDecoded(this, [](const QByteArray &result) {
+        return result.isEmpty() ? BannerList() : decodeBanners(result, true);
+    }, [this](const BannerList &list) {
+        if (!list.received) {
             return;
         }
+        netWorkSuc = true;
         emit networkStop(true);
-        createbannerData(result,true);
+        if (!list.json.isEmpty()) {
+            // replaced at once, LocalBannerThread never reads half of it
+            QSaveFile app_json(QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + QLatin1String("/bannersinfo.json"));
+            if (app_json.open(QIODevice::WriteOnly)) {
+                app_json.write(list.json);
+                app_json.commit();
+            }
+        }
+        setBanners(list);
     })
     .onError([this](QString errorStr) {
+        netWorkSuc = false;
         emit networkStop(false);
         return;
     })
     .timeout(10 * 1000)
     .exec();
-
-    localThread->start();
 }
 
 void BannerResourceModel::createbannerData(QByteArray bannerData,bool isNetworkRequest)
 {
-    qDebug() << Q_FUNC_INFO << " isNetworkRequest*******"<<isNetworkRequest;
+    setBanners(decodeBanners(bannerData, isNetworkRequest));
+}
 
+BannerResourceModel::BannerList BannerResourceModel::decodeBanners(const QByteArray &bannerData, bool isNetworkRequest)
+{
+    BannerList list;
+    list.received = true;
     if (isNetworkRequest) {
         QString path = QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + QLatin1String("/bannersinfo.json");
         QFile app_json(path);
-        if (app_json.open(QIODevice::ReadWrite)) {
-            QByteArray fileData =  app_json.readAll();
-            if (bannerData == fileData) {
-                return;
-            }
-            app_json.resize(0);
-            app_json.write(bannerData);
-            app_json.close();
+        if (app_json.open(QIODevice::ReadOnly) && app_json.readAll() == bannerData) {
+            return list;
         }
+        list.json = bannerData;
     }
+    list.changed = true;
 
-    beginResetModel();
-    m_banners.clear();
     QJsonObject jsonObjet= QJsonDocument::fromJson(bannerData).object();
     if (jsonObjet.empty()) {
-        return;
+        return list;
     }
     int code = jsonObjet["code"].toInt();
     if (code != 200) {
-        return;
+        return list;
     }
     auto jsonArray = jsonObjet["apps"].toArray();
     foreach (auto json, jsonArray) {
-        QString appName;
         QString banner =  json["banner"].toString();
-        appName =  json["appName"].toString();
-
-//        QJsonArray displaysArray = json[QString::fromUtf8("display")].toArray();
-//        foreach(auto display , displaysArray){
-//            QJsonObject displayObject = display.toObject();
-//            QString langP =  displayObject[QString::fromUtf8("lang")].toString();
-//            if(langP == currentLang){
-//                appName =  displayObject[QString::fromUtf8("name")].toString();
-//            }
-//        }
+        QString appName =  json["appName"].toString();
         if (!appName.isEmpty()) {
-            m_banners.append(new BannerAppResource(appName,banner));
+            list.banners.append({appName, banner});
         }
     }
-    endResetModel();
-
+    return list;
 }
 
+void BannerResourceModel::setBanners(const BannerList &list)
+{
+    if (!list.changed) {
+        return;
+    }
+
+    beginResetModel();
+    m_banners.clear();
+    for (const auto &banner : list.banners) {
+        m_banners.append(new BannerAppResource(banner.first, banner.second));
+    }
+    endResetModel();
+}
@@ -53,6 +53,17 @@ public Q_SLOTS:
     void createbannerData(QByteArray bannerData,bool isNetworkRequest);
 
 private:
+    /* what a banner response turns into on HttpClient's decoder threads */
+    struct BannerList {
+        bool received = false;
+        bool changed = false;
+        QByteArray json; // for bannersinfo.json, the decoders do not write it
+        QVector<QPair<QString, QString>> banners; // appName, banner
+    };
+    static BannerList decodeBanners(const QByteArray &bannerData, bool isNetworkRequest);
+    void setBanners(const BannerList &list);
+    void requestBanners();
+
     QList<BannerAppResource*> m_banners;
     bool netWorkSuc = false;
     LocalBannerThread *localThread;
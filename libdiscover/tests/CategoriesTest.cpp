@@ -49,6 +49,33 @@ private Q_SLOTS:
         auto categories = populateCategories();
         QVERIFY(!categories.isEmpty());
     }
+
+    void testIndices() {
+        auto create = [] {
+            QVector<Category*> ret;
+            for (int i = 0; i < 10; ++i)
+                ret += new Category(QStringLiteral("cat%1").arg(i), {}, {}, {}, {}, {}, false);
+            return ret;
+        };
+        auto width = [](const QVector<Category*>& cats) {
+            int ret = 0;
+            for (Category* cat : cats)
+                ret = qMax(ret, cat->index() + 1);
+            return ret;
+        };
+
+        const auto first = create();
+        const int firstWidth = width(first);
+        const int generation = Category::filtersGeneration();
+        qDeleteAll(first);
+        // resources forget what they know about the freed bits
+        QVERIFY(Category::filtersGeneration() != generation);
+
+        // loaded again, the new categories take over the indices of the old ones
+        const auto second = create();
+        QCOMPARE(width(second), firstWidth);
+        qDeleteAll(second);
+    }
 };
 
 QTEST_MAIN( CategoriesTest )
@@ -0,0 +1,502 @@
+/*
+ *   SPDX-FileCopyrightText: 2021 Wang Rui <wangrui@jingos.com>
+ *
+ *   SPDX-License-Identifier: GPL-2.0-only OR GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+ */
+
+#include <QtTest>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <network/HttpCache.h>
+#include <network/HttpClient.h>
+#include <network/ImageCache.h>
+#include <resources/ResourcesModel.h>
+#include <memory>
+
+// data: urls are answered by QNetworkAccessManager itself, nothing leaves the machine
+static const QString s_reply = QStringLiteral("data:application/json,{\"code\":200,\"message\":\"ok\"}");
+
+static void cacheEntry(HttpCache &cache, const QUrl &url, const QByteArray &data)
+{
+    QNetworkCacheMetaData metaData;
+    metaData.setUrl(url);
+    metaData.setSaveToDisk(true);
+    metaData.setExpirationDate(QDateTime::currentDateTime().addDays(1));
+    QIODevice *device = cache.prepare(metaData);
+    QVERIFY(device);
+    device->write(data);
+    cache.insert(device);
+}
+
+// Stand-in for the store API, answers every request on the same kept-alive connection
+class LocalServer : public QTcpServer
+{
+public:
+    LocalServer()
+    {
+        listen(QHostAddress::LocalHost);
+        connect(this, &QTcpServer::newConnection, this, [this] {
+            while (QTcpSocket *socket = nextPendingConnection()) {
+                ++connections;
+                connect(socket, &QTcpSocket::readyRead, socket, [this, socket] {
+                    if (!socket->readAll().contains("\r\n\r\n"))
+                        return;
+                    ++requests;
+                    const int delay = delays.isEmpty() ? 0 : delays.takeFirst();
+                    if (failures > 0) {
+                        --failures;
+                        answer(socket, delay, "HTTP/1.1 503 Service Unavailable\r\nConnection: keep-alive\r\nContent-Length: 0\r\n\r\n");
+                        return;
+                    }
+                    const QByteArray headers = "HTTP/1.1 200 OK\r\nContent-Type: application/json\r\nConnection: keep-alive\r\nContent-Length: "
+                                               + QByteArray::number(body.size()) + "\r\n\r\n";
+                    if (chunkDelay <= 0) {
+                        answer(socket, delay, headers + body);
+                        return;
+                    }
+                    // a slow link, the body comes a byte at a time
+                    socket->write(headers);
+                    for (int i = 0; i < body.size(); ++i) {
+                        QPointer<QTcpSocket> target(socket);
+                        const QByteArray byte = body.mid(i, 1);
+                        QTimer::singleShot((i + 1) * chunkDelay, this, [target, byte] {
+                            if (target)
+                                target->write(byte);
+                        });
+                    }
+                });
+            }
+        });
+    }
+
+    QString url() const
+    {
+        return QStringLiteral("http://127.0.0.1:%1/v1/applist").arg(serverPort());
+    }
+
+    // what every request gets
+    QByteArray body = "{\"code\":200}";
+    int connections = 0;
+    int requests = 0;
+    int failures = 0;
+    int chunkDelay = 0;
+    // how long each of the next requests waits for its answer, in the order they arrive
+    QVector<int> delays;
+
+private:
+    void answer(QTcpSocket *socket, int delay, const QByteArray &data)
+    {
+        if (delay <= 0) {
+            socket->write(data);
+            return;
+        }
+        QPointer<QTcpSocket> target(socket);
+        QTimer::singleShot(delay, this, [target, data] {
+            if (target)
+                target->write(data);
+        });
+    }
+};
+
+class HttpClientTest : public QObject
+{
+    Q_OBJECT
+public:
+    HttpClientTest()
+    {
+        QStandardPaths::setTestModeEnabled(true);
+        // responses listen to the network state, a model without backends keeps it unknown
+        new ResourcesModel(QStringLiteral("dummy-backend"), this);
+    }
+
+private Q_SLOTS:
+    void testResponse()
+    {
+        QByteArray data;
+        QVariantMap map;
+        QString error = QStringLiteral("none");
+        HttpClient::global()->get(s_reply)
+            .removePublicQueryParams()
+            .onResponse([&data](const QByteArray &result) { data = result; })
+            .onError([&error](QString errorString) { error = errorString; })
+            .exec();
+        HttpClient::global()->get(s_reply)
+            .removePublicQueryParams()
+            .cachePolicy(HttpRequest::NoCache)
+            .onResponse([&map](QVariantMap result) { map = result; })
+            .exec();
+
+        QTRY_VERIFY(!data.isEmpty());
+        QCOMPARE(data, QByteArray("{\"code\":200,\"message\":\"ok\"}"));
+        QTRY_COMPARE(map.value(QStringLiteral("code")).toInt(), 200);
+        QCOMPARE(error, QStringLiteral("none"));
+    }
+
+    void testCoalesced()
+    {
+        LocalServer server;
+        QVERIFY(server.isListening());
+
+        QVector<QByteArray> results;
+        for (int i = 0; i < 3; ++i) {
+            HttpClient::global()->get(server.url())
+                .removePublicQueryParams()
+                .cachePolicy(HttpRequest::NoCache)
+                .onResponse([&results](QByteArray result) { results += result; })
+                .exec();
+        }
+        QTRY_COMPARE(results.count(), 3);
+        // one went on the wire, all of them got its answer
+        QCOMPARE(server.requests, 1);
+        QCOMPARE(results.at(0), QByteArray("{\"code\":200}"));
+        QCOMPARE(results.at(1), results.at(0));
+        QCOMPARE(results.at(2), results.at(0));
+    }
+
+    void testConnectionReuse()
+    {
+        LocalServer server;
+        QVERIFY(server.isListening());
+        HttpClient::global()->preconnect(QUrl(server.url()));
+        QTRY_COMPARE(server.connections, 1);
+
+        int responses = 0;
+        for (int i = 0; i < 3; ++i) {
+            HttpClient::global()->get(server.url())
+                .removePublicQueryParams()
+                .cachePolicy(HttpRequest::NoCache)
+                .onResponse([&responses](QByteArray result) { responses += !result.isEmpty(); })
+                .exec();
+            QTRY_COMPARE(responses, i + 1);
+        }
+        QCOMPARE(server.connections, 1);
+
+        const HttpClient::HostStats stats = HttpClient::global()->hostStats(QStringLiteral("127.0.0.1"));
+        QCOMPARE(stats.requests, 3);
+        QCOMPARE(stats.inFlight, 0);
+        QCOMPARE(stats.errors, 0);
+        QCOMPARE(stats.http2, 0);
+        QCOMPARE(HttpClient::global()->connectionStats().value(QStringLiteral("127.0.0.1")).toMap().value(QStringLiteral("requests")).toInt(), 3);
+    }
+
+    void testPriorities()
+    {
+        HttpClient *client = HttpClient::global();
+        client->setMaxRunning(HttpRequest::Background, 1);
+
+        // slots taking the reply are never coalesced
+        int background = 0;
+        for (int i = 0; i < 3; ++i) {
+            client->get(s_reply)
+                .removePublicQueryParams()
+                .priority(HttpRequest::Background)
+                .onResponse([&background](QNetworkReply *reply) { ++background; reply->deleteLater(); })
+                .exec();
+        }
+        int interactive = 0;
+        client->get(s_reply)
+            .removePublicQueryParams()
+            .onResponse([&interactive](QNetworkReply *reply) { ++interactive; reply->deleteLater(); })
+            .exec();
+
+        QCOMPARE(client->priorityStats(HttpRequest::Background).queued, 2);
+        QCOMPARE(client->priorityStats(HttpRequest::Background).running, 1);
+        QCOMPARE(client->priorityStats(HttpRequest::Interactive).queued, 0);
+        QTRY_COMPARE(interactive, 1);
+        QTRY_COMPARE(background, 3);
+        QCOMPARE(client->priorityStats(HttpRequest::Background).queued, 0);
+        QVERIFY(client->priorityStats(HttpRequest::Background).maxQueued >= 2);
+        QCOMPARE(client->schedulerStats().value(QStringLiteral("background")).toMap().value(QStringLiteral("queued")).toInt(), 0);
+        client->setMaxRunning(HttpRequest::Background, 2);
+    }
+
+    void testRetries()
+    {
+        LocalServer server;
+        QVERIFY(server.isListening());
+        server.failures = 1;
+
+        QByteArray data;
+        QString error;
+        HttpClient::global()->get(server.url())
+            .removePublicQueryParams()
+            .cachePolicy(HttpRequest::NoCache)
+            .onResponse([&data](QByteArray result) { data = result; })
+            .onError([&error](QString errorString) { error = errorString; })
+            .exec();
+        QTRY_VERIFY(!data.isEmpty());
+        QCOMPARE(server.requests, 2);
+        QVERIFY(error.isEmpty());
+
+        // posting twice could do things twice
+        server.failures = 1;
+        HttpClient::global()->post(server.url())
+            .removePublicQueryParams()
+            .onError([&error](QString errorString) { error = errorString; })
+            .exec();
+        QTRY_VERIFY(!error.isEmpty());
+        QCOMPARE(server.requests, 3);
+
+        QCOMPARE(HttpClient::global()->latencyPercentile(QUrl(server.url()), 95), -1);
+        int responses = 0;
+        for (int i = 0; i < 8; ++i) {
+            HttpClient::global()->get(server.url())
+                .removePublicQueryParams()
+                .cachePolicy(HttpRequest::NoCache)
+                .onResponse([&responses](QNetworkReply *reply) { ++responses; reply->deleteLater(); })
+                .exec();
+        }
+        QTRY_COMPARE(responses, 8);
+        QVERIFY(HttpClient::global()->latencyPercentile(QUrl(server.url()), 95) >= 0);
+    }
+
+    void testStaleWhileRevalidate()
+    {
+        LocalServer server;
+        QVERIFY(server.isListening());
+        QUrl url(server.url());
+        url.setPath(QStringLiteral("/v1/banners"));
+        HttpClient *client = HttpClient::global();
+        client->cache()->remove(url);
+
+        QByteArray data;
+        client->get(url.toString())
+            .removePublicQueryParams()
+            .cachePolicy(HttpRequest::CacheFirst)
+            .onResponse([&data](QByteArray result) { data = result; })
+            .exec();
+        QTRY_VERIFY(!data.isEmpty());
+        QCOMPARE(server.requests, 1);
+
+        // answered from the cache, refreshed like any other background request
+        const int started = client->priorityStats(HttpRequest::Background).started;
+        data.clear();
+        client->get(url.toString())
+            .removePublicQueryParams()
+            .cachePolicy(HttpRequest::StaleWhileRevalidate)
+            .onResponse([&data](QByteArray result) { data = result; })
+            .exec();
+        QCOMPARE(client->priorityStats(HttpRequest::Background).started, started + 1);
+        QTRY_VERIFY(!data.isEmpty());
+        QCOMPARE(data, QByteArray("{\"code\":200}"));
+        QTRY_COMPARE(client->priorityStats(HttpRequest::Background).running, 0);
+    }
+
+    void testHedged_data()
+    {
+        QTest::addColumn<int>("primaryDelay");
+        QTest::addColumn<int>("hedgeDelay");
+        QTest::addColumn<int>("failures");
+        QTest::newRow("slow primary") << 3000 << 0 << 0;
+        QTest::newRow("primary fails") << 300 << 600 << 1;
+    }
+
+    void testHedged()
+    {
+        QFETCH(int, primaryDelay);
+        QFETCH(int, hedgeDelay);
+        QFETCH(int, failures);
+        LocalServer server;
+        QVERIFY(server.isListening());
+        HttpClient *client = HttpClient::global();
+
+        // the endpoint needs a p95 before anything gets hedged
+        int responses = 0;
+        for (int i = 0; i < 8; ++i) {
+            client->get(server.url())
+                .removePublicQueryParams()
+                .cachePolicy(HttpRequest::NoCache)
+                .onResponse([&responses](QNetworkReply *reply) { ++responses; reply->deleteLater(); })
+                .exec();
+        }
+        QTRY_COMPARE(responses, 8);
+        QVERIFY(client->latencyPercentile(QUrl(server.url()), 95) >= 0);
+
+        server.requests = 0;
+        server.delays = { primaryDelay, hedgeDelay };
+        server.failures = failures;
+        const int started = client->priorityStats(HttpRequest::Interactive).started;
+        QElapsedTimer timer;
+        timer.start();
+        QByteArray data;
+        QString error;
+        client->get(server.url())
+            .removePublicQueryParams()
+            .cachePolicy(HttpRequest::NoCache)
+            .hedged()
+            .retries(0)
+            .onResponse([&data](QByteArray result) { data = result; })
+            .onError([&error](QString errorString) { error = errorString; })
+            .exec();
+        QTRY_VERIFY_WITH_TIMEOUT(!data.isEmpty() || !error.isEmpty(), 5000);
+        QVERIFY2(error.isEmpty(), qPrintable(error));
+        QCOMPARE(data, QByteArray("{\"code\":200}"));
+        QCOMPARE(server.requests, 2);
+        if (failures == 0)
+            QVERIFY(timer.elapsed() < primaryDelay);
+
+        // the copy is scheduled like any other request
+        QCOMPARE(client->priorityStats(HttpRequest::Interactive).started, started + 2);
+        QTRY_COMPARE(client->priorityStats(HttpRequest::Interactive).running, 0);
+    }
+
+    void testIdleTimeout()
+    {
+        LocalServer server;
+        QVERIFY(server.isListening());
+        server.chunkDelay = 100;
+
+        // takes longer than the timeout as a whole, but never stalls for that long
+        QByteArray data;
+        QString error;
+        HttpClient::global()->get(server.url())
+            .removePublicQueryParams()
+            .cachePolicy(HttpRequest::NoCache)
+            .timeout(500)
+            .onResponse([&data](QByteArray result) { data = result; })
+            .onError([&error](QString errorString) { error = errorString; })
+            .exec();
+        QTRY_VERIFY_WITH_TIMEOUT(!data.isEmpty() || !error.isEmpty(), 5000);
+        QCOMPARE(data, QByteArray("{\"code\":200}"));
+        QVERIFY(error.isEmpty());
+        QCOMPARE(server.requests, 1);
+    }
+
+    void testThumbnails()
+    {
+        QImage icon(256, 128, QImage::Format_RGB32);
+        icon.fill(Qt::red);
+        QByteArray png;
+        QBuffer buffer(&png);
+        icon.save(&buffer, "PNG");
+        const QUrl url(QStringLiteral("data:image/png;base64,") + QString::fromLatin1(png.toBase64()));
+
+        ImageCache *cache = ImageCache::global();
+        const QSize size(64, 64);
+        QFile::remove(cache->thumbnailPath(url, size));
+        QImage image;
+        cache->load(url, size, this, [&image](const QImage &result) { image = result; });
+        QTRY_VERIFY(!image.isNull());
+        QCOMPARE(image.size(), QSize(64, 32));
+        QCOMPARE(image.format(), QImage::Format_ARGB32_Premultiplied);
+        QCOMPARE(image.pixelColor(10, 10), QColor(Qt::red));
+        QVERIFY(QFile::exists(cache->thumbnailPath(url, size)));
+
+        // answered from the thumbnail, loads of the same image share it
+        image = QImage();
+        QImage other;
+        cache->load(url, size, this, [&image](const QImage &result) { image = result; });
+        cache->load(url, size, this, [&other](const QImage &result) { other = result; });
+        QTRY_VERIFY(!image.isNull());
+        QCOMPARE(other, image);
+        QCOMPARE(image.size(), QSize(64, 32));
+
+        bool failed = false;
+        cache->load(QUrl(QStringLiteral("data:image/png;base64,AAAA")), size, this, [&failed](const QImage &result) { failed = result.isNull(); });
+        QTRY_VERIFY(failed);
+    }
+
+    void testCacheEviction()
+    {
+        QTemporaryDir dir;
+        const QByteArray data(10 * 1024, 'x');
+        const QUrl first(QStringLiteral("http://127.0.0.1/first.png"));
+        const QUrl second(QStringLiteral("http://127.0.0.1/second.png"));
+        const QUrl third(QStringLiteral("http://127.0.0.1/third.png"));
+
+        // room for two entries
+        HttpCache cache(dir.path(), 25 * 1024);
+        cacheEntry(cache, first, data);
+        cacheEntry(cache, second, data);
+        // written hours ago, the second after the first, so that using them refreshes them
+        QDirIterator it(dir.path(), {QStringLiteral("*.d")}, QDir::Files, QDirIterator::Subdirectories);
+        while (it.hasNext()) {
+            QFile file(it.next());
+            const int hours = cache.fileMetaData(file.fileName()).url() == first ? 2 : 1;
+            QVERIFY(file.open(QIODevice::ReadWrite));
+            file.setFileTime(QDateTime::currentDateTime().addSecs(-hours * 3600), QFileDevice::FileModificationTime);
+        }
+
+        // used through another cache on the same directory, like another thread's would
+        {
+            HttpCache other(dir.path(), 25 * 1024);
+            std::unique_ptr<QIODevice> device(other.data(first));
+            QVERIFY(device);
+            QCOMPARE(device->readAll(), data);
+        }
+        QTest::qWait(50);
+        cacheEntry(cache, third, data);
+
+        // what the next start finds
+        HttpCache restarted(dir.path(), 25 * 1024);
+        QVERIFY(restarted.metaData(first).isValid());
+        QVERIFY(!restarted.metaData(second).isValid());
+        QVERIFY(restarted.metaData(third).isValid());
+    }
+
+    void testScreenshotCache()
+    {
+        LocalServer server;
+        QVERIFY(server.isListening());
+        QImage screenshot(320, 200, QImage::Format_RGB32);
+        screenshot.fill(Qt::blue);
+        server.body.clear();
+        QBuffer buffer(&server.body);
+        screenshot.save(&buffer, "PNG");
+        QUrl url(server.url());
+        url.setPath(QStringLiteral("/screenshots/1.png"));
+
+        ImageCache *cache = ImageCache::global();
+        HttpClient::global()->cache()->remove(url);
+        const QSize large(160, 160);
+        const QSize small(80, 80);
+        QFile::remove(cache->thumbnailPath(url, large));
+        QFile::remove(cache->thumbnailPath(url, small));
+        const QVariantMap before = cache->stats();
+        auto counted = [&before, cache](const char *name) {
+            const QString key = QLatin1String(name);
+            return int(cache->stats().value(key).toLongLong() - before.value(key).toLongLong());
+        };
+
+        // every time the screenshot is shown again, the smaller one is made from the cached original
+        for (const QSize &size : {large, large, small}) {
+            QImage image;
+            cache->load(url, size, this, [&image](const QImage &result) { image = result; });
+            QTRY_VERIFY(!image.isNull());
+            QCOMPARE(image.pixelColor(10, 10), QColor(Qt::blue));
+        }
+        QCOMPARE(server.requests, 1);
+
+        QCOMPARE(counted("thumbnailHits"), 1);
+        QCOMPARE(counted("thumbnailMisses"), 2);
+        QCOMPARE(counted("hits"), 1);
+        QCOMPARE(counted("misses"), 1);
+        QCOMPARE(counted("bytesSaved"), server.body.size());
+    }
+
+    // What sending an actionReport costs before anything goes on the wire
+    void benchmarkRequestSetup()
+    {
+        QJsonObject report;
+        report[QStringLiteral("appName")] = QStringLiteral("kalgebra");
+        report[QStringLiteral("actionType")] = QStringLiteral("install");
+        report[QStringLiteral("resultCode")] = 200;
+
+        QBENCHMARK {
+            HttpResponse *response = HttpClient::global()->post(s_reply)
+                .header(QStringLiteral("content-type"), QStringLiteral("application/json"))
+                .body(report)
+                .onResponse([](QByteArray) {})
+                .onError([](QString) {})
+                .timeout(10 * 1000)
+                .removePublicQueryParams()
+                .exec();
+            QVERIFY(response);
+            delete response->networkReply();
+        }
+    }
+};
+
+QTEST_GUILESS_MAIN(HttpClientTest)
+
+#include "HttpClientTest.moc"
@@ -0,0 +1,331 @@
+/*
+ *   SPDX-FileCopyrightText: 2021 Wang Rui <wangrui@jingos.com>
+ *
+ *   SPDX-License-Identifier: GPL-2.0-only OR GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+ */
+
+#include <QtTest>
+#include <resources/AbstractResource.h>
+#include <resources/ResourcesDuplicatesIndex.h>
+#include <resources/ResourcesModel.h>
+#include <resources/ResourcesProxyModel.h>
+
+class TestResource : public AbstractResource
+{
+    Q_OBJECT
+public:
+    TestResource(const QString &name, const QString &appstreamId, const QSet<QString> &alternatives = {})
+        : AbstractResource(nullptr)
+        , m_name(name)
+        , m_appstreamId(appstreamId)
+        , m_alternatives(alternatives)
+    {}
+
+    QString appstreamId() const override { return m_appstreamId; }
+    QSet<QString> alternativeAppstreamIds() const override { return m_alternatives; }
+    QString packageName() const override { return m_name; }
+    QString name() const override { return m_name; }
+    QString comment() override { return m_name; }
+    QVariant icon() const override { return QStringLiteral("kalgebra"); }
+    bool canExecute() const override { return false; }
+    void invokeApplication() const override {}
+    State state() override { return None; }
+    QStringList categories() override { return {}; }
+    Type type() const override { return Application; }
+    int size() override { return 42; }
+    QJsonArray licenses() override { return {}; }
+    QString installedVersion() const override { return {}; }
+    QString availableVersion() const override { return {}; }
+    QString longDescription() override { return {}; }
+    QString origin() const override { return {}; }
+    QString section() override { return {}; }
+    QString author() const override { return {}; }
+    QList<PackageState> addonsInformation() override { return {}; }
+    QString sourceIcon() const override { return {}; }
+    QDate releaseDate() const override { return {}; }
+    void fetchChangelog() override {}
+
+private:
+    const QString m_name;
+    const QString m_appstreamId;
+    const QSet<QString> m_alternatives;
+};
+
+// Every app comes from three sources, one of them only knows it by its old id
+static QVector<AbstractResource*> createStream(int apps)
+{
+    QVector<AbstractResource*> ret;
+    ret.reserve(apps * 3);
+    for (int i = 0; i < apps; ++i) {
+        const QString name = QStringLiteral("app%1").arg(i);
+        const QString id = QStringLiteral("org.kde.%1").arg(name);
+        const QString oldId = name + QLatin1String(".desktop");
+        ret += new TestResource(name, id, {oldId});
+        ret += new TestResource(name, oldId);
+        ret += new TestResource(name, id);
+    }
+    return ret;
+}
+
+// Distinct apps whose names sort like their numbers
+static QVector<AbstractResource*> createApps(int first, int count, int step)
+{
+    QVector<AbstractResource*> ret;
+    ret.reserve(count);
+    for (int i = 0; i < count; ++i) {
+        const QString name = QStringLiteral("app%1").arg(first + i * step, 6, 10, QLatin1Char('0'));
+        ret += new TestResource(name, QLatin1String("org.kde.") + name);
+    }
+    return ret;
+}
+
+class ResourcesProxyModelTest : public QObject
+{
+    Q_OBJECT
+public:
+    ResourcesProxyModelTest()
+    {
+        // without backends it has no current one, every duplicate takes over from the one shown
+        new ResourcesModel(QStringLiteral("dummy-backend"), this);
+    }
+
+private Q_SLOTS:
+    void testDuplicates()
+    {
+        TestResource a(QStringLiteral("a"), QStringLiteral("org.kde.a"), {QStringLiteral("a.desktop")});
+        TestResource aOld(QStringLiteral("a"), QStringLiteral("a.desktop"));
+        TestResource aNew(QStringLiteral("a"), QStringLiteral("org.kde.a.next"), {QStringLiteral("org.kde.a")});
+        TestResource b(QStringLiteral("b"), QStringLiteral("org.kde.b"));
+        TestResource noId(QStringLiteral("c"), {});
+
+        ResourcesDuplicatesIndex index;
+        QCOMPARE(index.findOrInsert(&a), nullptr);
+        QCOMPARE(index.findOrInsert(&a), &a);
+        QCOMPARE(index.findOrInsert(&aOld), &a);
+        QCOMPARE(index.findOrInsert(&aNew), &a);
+        QCOMPARE(index.findOrInsert(&b), nullptr);
+        QCOMPARE(index.findOrInsert(&noId), nullptr);
+        QCOMPARE(index.findOrInsert(&noId), nullptr);
+        QCOMPARE(index.count(), 2);
+
+        index.replace(&a, &aOld);
+        QCOMPARE(index.findOrInsert(&a), &aOld);
+        QCOMPARE(index.count(), 2);
+
+        index.remove(&b);
+        QCOMPARE(index.count(), 1);
+        QCOMPARE(index.findOrInsert(&b), nullptr);
+        index.clear();
+        QCOMPARE(index.count(), 0);
+    }
+
+    void testAddDuplicates()
+    {
+        TestResource a(QStringLiteral("a"), QStringLiteral("org.kde.a"), {QStringLiteral("a.desktop")});
+        TestResource aOld(QStringLiteral("a"), QStringLiteral("a.desktop"));
+        TestResource b(QStringLiteral("b"), QStringLiteral("org.kde.b"));
+        TestResource bNext(QStringLiteral("b2"), QStringLiteral("org.kde.b.next"), {QStringLiteral("org.kde.b")});
+        TestResource c(QStringLiteral("c"), QStringLiteral("org.kde.c"));
+
+        ResourcesProxyModel model;
+        QSignalSpy changed(&model, &QAbstractItemModel::dataChanged);
+        model.addResources({ &a, &c });
+        // one replaces a row that is shown, the other one of its own batch
+        model.addResources({ &aOld, &b, &bNext });
+        QCOMPARE(model.rowCount(), 3);
+        QCOMPARE(model.resourceAt(0), &aOld);
+        QCOMPARE(model.resourceAt(1), &bNext);
+        QCOMPARE(model.resourceAt(2), &c);
+        QCOMPARE(changed.count(), 1);
+        QCOMPARE(changed.first().first().toModelIndex().row(), 0);
+    }
+
+    void benchmarkAddResources_data()
+    {
+        QTest::addColumn<int>("apps");
+        QTest::newRow("5k") << 5000;
+        QTest::newRow("10k") << 10000;
+        QTest::newRow("20k") << 20000;
+    }
+
+    // a whole search, every app found by three backends, in batches the way the streams deliver them
+    void benchmarkAddResources()
+    {
+        QFETCH(int, apps);
+        const auto stream = createStream(apps);
+        QBENCHMARK {
+            ResourcesProxyModel model;
+            for (int i = 0; i < stream.size(); i += 200)
+                model.addResources(stream.mid(i, 200));
+            QCOMPARE(model.rowCount(), apps);
+        }
+        qDeleteAll(stream);
+    }
+
+    void testSortedInsertion()
+    {
+        const auto even = createApps(0, 50, 2);
+        const auto odd = createApps(1, 50, 2);
+        ResourcesProxyModel model;
+        QSignalSpy inserted(&model, &QAbstractItemModel::rowsInserted);
+        QSignalSpy reset(&model, &QAbstractItemModel::modelReset);
+        model.addResources(even);
+        QCOMPARE(inserted.count(), 1);
+
+        // two runs, inserted where they go
+        model.addResources({ odd.at(0), odd.at(30) });
+        QCOMPARE(inserted.count(), 3);
+        QCOMPARE(inserted.at(1).at(1).toInt(), 1);
+        QCOMPARE(inserted.at(1).at(2).toInt(), 1);
+        QCOMPARE(inserted.at(2).at(1).toInt(), 32);
+        QCOMPARE(reset.count(), 0);
+
+        // runs all over the list, merged at once
+        model.addResources(odd.mid(1, 29) + odd.mid(31));
+        QCOMPARE(inserted.count(), 3);
+        QCOMPARE(reset.count(), 1);
+        QCOMPARE(model.rowCount(), 100);
+        for (int row = 0; row < 100; ++row)
+            QCOMPARE(model.resourceAt(row), row % 2 ? odd.at(row / 2) : even.at(row / 2));
+
+        qDeleteAll(even);
+        qDeleteAll(odd);
+    }
+
+    void benchmarkSortedInsertion_data()
+    {
+        QTest::addColumn<int>("apps");
+        QTest::newRow("5k") << 5000;
+        QTest::newRow("10k") << 10000;
+        QTest::newRow("20k") << 20000;
+    }
+
+    // batches that interleave with everything already shown, the worst case for inserting rows
+    void benchmarkSortedInsertion()
+    {
+        QFETCH(int, apps);
+        const auto even = createApps(0, apps / 2, 2);
+        const auto odd = createApps(1, apps / 2, 2);
+        QBENCHMARK {
+            ResourcesProxyModel model;
+            model.addResources(even);
+            for (int i = 0; i < 10; ++i) {
+                QVector<AbstractResource*> batch;
+                for (int j = i; j < odd.count(); j += 10)
+                    batch += odd.at(j);
+                model.addResources(batch);
+            }
+            QCOMPARE(model.rowCount(), apps);
+        }
+        qDeleteAll(even);
+        qDeleteAll(odd);
+    }
+
+    void testData()
+    {
+        TestResource a(QStringLiteral("a"), QStringLiteral("org.kde.a"));
+        ResourcesProxyModel model;
+        model.addResources({ &a });
+
+        const QModelIndex idx = model.index(0, 0);
+        QCOMPARE(idx.data(ResourcesProxyModel::NameRole).toString(), QStringLiteral("a"));
+        QCOMPARE(idx.data(ResourcesProxyModel::IconRole).toString(), QStringLiteral("kalgebra"));
+        QCOMPARE(idx.data(ResourcesProxyModel::StateRole).value<AbstractResource::State>(), AbstractResource::None);
+        QCOMPARE(idx.data(ResourcesProxyModel::ApplicationRole).value<QObject*>(), &a);
+        QCOMPARE(idx.data(ResourcesProxyModel::PackageNameRole).toString(), QStringLiteral("a"));
+        QCOMPARE(idx.data(ResourcesProxyModel::SizeRole).toInt(), 42);
+        QCOMPARE(idx.data(ResourcesProxyModel::InstalledRole).toBool(), false);
+        QVERIFY(!idx.data(Qt::DisplayRole).isValid());
+        QVERIFY(!idx.data(ResourcesProxyModel::ReleaseDateRole + 1).isValid());
+    }
+
+    void testSubcategories()
+    {
+        Category one(QStringLiteral("One"), {}, { {PkgNameFilter, QStringLiteral("app1")} }, {}, {}, {}, false);
+        Category kde(QStringLiteral("KDE"), {}, { {AppstreamIdWildcardFilter, QStringLiteral("org.kde.*")} }, {}, {}, {}, false);
+        Category apps(QStringLiteral("Apps"), {}, { {PkgWildcardFilter, QStringLiteral("*app*")} }, {}, { &one, &kde }, {}, false);
+        Category all(QStringLiteral("All"), {}, {}, {}, { &apps }, {}, false);
+        TestResource app1(QStringLiteral("app1"), QStringLiteral("org.kde.app1"));
+        TestResource app2(QStringLiteral("app2"), QStringLiteral("app2.desktop"));
+        TestResource other(QStringLiteral("other"), QStringLiteral("org.kde.other"));
+
+        QCOMPARE(app1.categoryObjects({ &apps }), (QSet<Category*>{ &one, &kde }));
+        QCOMPARE(app2.categoryObjects({ &apps }), QSet<Category*>{ &apps });
+        QVERIFY(other.categoryObjects({ &apps }).isEmpty());
+
+        ResourcesProxyModel model;
+        // not set up by QML, setting the category does not start a search
+        model.setFiltersFromCategory(&all);
+        model.addResources({ &app1, &app2, &other });
+        QCOMPARE(model.subcategories().count(), 3);
+        QVERIFY(model.subcategories().contains(QVariant::fromValue<QObject*>(&one)));
+        QVERIFY(model.subcategories().contains(QVariant::fromValue<QObject*>(&kde)));
+        QVERIFY(model.subcategories().contains(QVariant::fromValue<QObject*>(&apps)));
+
+        // the cached matches follow the filters
+        QVERIFY(app1.categoryMatches(&kde));
+        kde.setAndFilter({ {PkgNameFilter, QStringLiteral("app3")} });
+        QVERIFY(!app1.categoryMatches(&kde));
+        // the next results found look at every row again
+        model.removeResource(&other);
+        model.addResources({ &other });
+        QCOMPARE(model.subcategories().count(), 2);
+    }
+
+    void testWaitingForMore()
+    {
+        auto first = new ResultsStream(QStringLiteral("first"));
+        auto second = new ResultsStream(QStringLiteral("second"));
+        AggregatedResultsStream aggregated({first, second});
+        int fetches = 0;
+        connect(first, &ResultsStream::fetchMore, this, [&fetches] { ++fetches; });
+
+        first->setWaitingForMore(true);
+        QVERIFY(!aggregated.isWaitingForMore());
+        second->setWaitingForMore(true);
+        QVERIFY(aggregated.isWaitingForMore());
+
+        Q_EMIT aggregated.fetchMore();
+        QCOMPARE(fetches, 1);
+        first->setWaitingForMore(false);
+        QVERIFY(!aggregated.isWaitingForMore());
+
+        // a stream that is over does not hold back the others
+        delete first;
+        QVERIFY(aggregated.isWaitingForMore());
+    }
+
+    void benchmarkData_data()
+    {
+        QTest::addColumn<QVector<int>>("roles");
+        QTest::newRow("delegate") << QVector<int>{ ResourcesProxyModel::NameRole, ResourcesProxyModel::IconRole, ResourcesProxyModel::CommentRole,
+                                                   ResourcesProxyModel::StateRole, ResourcesProxyModel::ApplicationRole };
+        QTest::newRow("properties") << QVector<int>{ ResourcesProxyModel::PackageNameRole, ResourcesProxyModel::InstalledRole, ResourcesProxyModel::CanUpgrade,
+                                                     ResourcesProxyModel::SizeRole, ResourcesProxyModel::OriginRole, ResourcesProxyModel::SectionRole };
+    }
+
+    // data() calls for 1000 rows, as many as a scrolling view asks for
+    void benchmarkData()
+    {
+        QFETCH(QVector<int>, roles);
+        const auto apps = createApps(0, 1000, 1);
+        ResourcesProxyModel model;
+        model.addResources(apps);
+
+        const int rows = model.rowCount();
+        QBENCHMARK {
+            int valid = 0;
+            for (int row = 0; row < rows; ++row) {
+                const QModelIndex idx = model.index(row, 0);
+                for (int role : roles)
+                    valid += idx.data(role).isValid();
+            }
+            QCOMPARE(valid, rows * roles.count());
+        }
+        qDeleteAll(apps);
+    }
+};
+
+QTEST_GUILESS_MAIN(ResourcesProxyModelTest)
+
+#include "ResourcesProxyModelTest.moc"
@@ -0,0 +1,45 @@
+/*
+ *   SPDX-FileCopyrightText: 2021 Wang Rui <wangrui@jingos.com>
+ *
+ *   SPDX-License-Identifier: GPL-2.0-only OR GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+ */
+
+#include <QtTest>
+#include <resources/StringPool.h>
+
+class StringPoolTest : public QObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+    void testIntern()
+    {
+        StringPool pool;
+        const QString name = QString::fromLatin1("kalgebra");
+        const QString interned = pool.intern(name);
+        QVERIFY(interned.isSharedWith(name));
+
+        // decoded again, handed out the same data
+        const QString chars = QStringLiteral("..kalgebra..");
+        const QString again = pool.intern(QStringView(chars).mid(2, 8));
+        QCOMPARE(again, name);
+        QVERIFY(again.isSharedWith(interned));
+        QVERIFY(pool.intern(QString()).isNull());
+
+        StringPool::Stats stats = pool.stats();
+        QCOMPARE(stats.strings, 1);
+        QCOMPARE(stats.lookups, 2);
+        QCOMPARE(stats.hits, 1);
+        QCOMPARE(stats.bytesSaved, qint64(8 * sizeof(QChar)));
+
+        // still held here
+        QCOMPARE(pool.squeeze(), 0);
+        pool.intern(QString::fromLatin1("unused"));
+        QCOMPARE(pool.squeeze(), 1);
+        QCOMPARE(pool.stats().strings, 1);
+        QVERIFY(pool.report().value(QStringLiteral("residentBytes")).toLongLong() > 0);
+    }
+};
+
+QTEST_GUILESS_MAIN(StringPoolTest)
+
+#include "StringPoolTest.moc"